@@ -24,26 +24,268 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include "fft_plan.h"
+#include "fft_queue.h"
+
 /* dynamic segment id */
 #define MATRIX_SEGMENT_ID (10)
+/* segment holding the fft_plan_t shared by the IO and the clusters */
+#define PLAN_SEGMENT_ID (MATRIX_SEGMENT_ID+2)
+/* segment holding the filter spectrum of the convolution (FFT_MODE_CONV) */
+#define FILTER_SEGMENT_ID (MATRIX_SEGMENT_ID+3)
+/* segment holding the fft_mailbox_t of the resident service (FFT_SERVICE) */
+#define MAILBOX_SEGMENT_ID (MATRIX_SEGMENT_ID+4)
+/* cluster groups (FFT_GROUPS of the IO): each group has its own matrix,
+ * output, plan, filter and mailbox segments, shifted by FFT_GROUP_SEGMENTS ids */
+#define FFT_GROUP_SEGMENTS (5)
+#define GROUP_SEGMENT_ID(id, g) ((id) + (g)*FFT_GROUP_SEGMENTS)
+#define FFT_MAX_GROUP (16)
+#if FFT_QUEUE_SEGMENT_ID < MATRIX_SEGMENT_ID + FFT_MAX_GROUP*FFT_GROUP_SEGMENTS
+#error "Please the host queue window needs a segment id above the group segments\n"
+#endif
+
+/* transform benchmarked (mode= at build time) */
+#define FFT_MODE_FORWARD (0)
+#define FFT_MODE_INVERSE (1)	/* scaled by 1/(WIDTH*HEIGHT) */
+#define FFT_MODE_CONV    (2)	/* circular convolution with a filter */
+#ifndef FFT_MODE
+#define FFT_MODE (FFT_MODE_FORWARD)
+#endif
+
+/* window applied to the input (window= at build time), fused in the first
+ * FFT pass: w(n) = A0 - A1*cos(2*pi*n/N) + A2*cos(4*pi*n/N), n = row*WIDTH + col */
+#define FFT_WINDOW_NONE     (0)
+#define FFT_WINDOW_HANN     (1)
+#define FFT_WINDOW_HAMMING  (2)
+#define FFT_WINDOW_BLACKMAN (3)
+#ifndef FFT_WINDOW
+#define FFT_WINDOW (FFT_WINDOW_NONE)
+#endif
+#if FFT_WINDOW == FFT_WINDOW_HANN
+#define FFT_WINDOW_A0 (0.5f)
+#define FFT_WINDOW_A1 (0.5f)
+#define FFT_WINDOW_A2 (0.0f)
+#elif FFT_WINDOW == FFT_WINDOW_HAMMING
+#define FFT_WINDOW_A0 (0.54f)
+#define FFT_WINDOW_A1 (0.46f)
+#define FFT_WINDOW_A2 (0.0f)
+#elif FFT_WINDOW == FFT_WINDOW_BLACKMAN
+#define FFT_WINDOW_A0 (0.42f)
+#define FFT_WINDOW_A1 (0.5f)
+#define FFT_WINDOW_A2 (0.08f)
+#endif
+
+/* output stage (output= at build time), fused in the last FFT pass: the
+ * clusters write one float per point instead of one complex */
+#define FFT_OUTPUT_COMPLEX   (0)
+#define FFT_OUTPUT_POWER     (1)	/* |X|^2 */
+#define FFT_OUTPUT_MAGNITUDE (2)	/* |X| */
+#define FFT_OUTPUT_DB        (3)	/* 10*log10(|X|^2 + FFT_DB_FLOOR) */
+#ifndef FFT_OUTPUT
+#define FFT_OUTPUT (FFT_OUTPUT_COMPLEX)
+#endif
+#define FFT_DB_FLOOR (1e-30f)
+/* size of an output point in bytes */
+#define FFT_OUTPUT_SIZE (FFT_OUTPUT == FFT_OUTPUT_COMPLEX ? 8 : 4)
+
+/* order of the output (order= at build time) */
+#define FFT_ORDER_NATURAL    (0)	/* bin k at index k */
+#define FFT_ORDER_TRANSPOSED (1)	/* bin k = k1 + HEIGHT*k2 at index k1*WIDTH + k2, no last transpose */
+#ifndef FFT_ORDER
+#define FFT_ORDER (FFT_ORDER_NATURAL)
+#endif
+/* transposed order of a @p w x @p h FFT: index of bin @p k, bin at index @p i */
+#define FFT_TRANSPOSED_INDEX(k, w, h) (((k) % (h))*(w) + (k)/(h))
+#define FFT_TRANSPOSED_BIN(i, w, h) (((i) % (w))*(h) + (i)/(w))
 
 /* tile */
+#ifndef TILE
 #define TILE (256) 	/* to configure the matrix size of transpose in-chip */
-#define TILE_WIDTH (TILE)
-#define TILE_HEIGHT (TILE/NB_CLUSTER)
+#endif
+
+/* global matrix, WIDTH x HEIGHT points (any size, see fft_row_plan_create()) */
+#ifndef WIDTH
+#define WIDTH (TILE)
+#endif
+#ifndef HEIGHT
+#define HEIGHT (TILE)
+#endif
+
+/* pruned FFT (input_points=, output_first=, output_points= at build time):
+ * the input is zero after its FFT_INPUT_POINTS first points (zero padding)
+ * and only the bins [FFT_OUTPUT_FIRST, FFT_OUTPUT_FIRST+FFT_OUTPUT_POINTS)
+ * of the output are needed */
+#ifndef FFT_INPUT_POINTS
+#define FFT_INPUT_POINTS (WIDTH*HEIGHT)
+#endif
+#ifndef FFT_OUTPUT_FIRST
+#define FFT_OUTPUT_FIRST (0)
+#endif
+#ifndef FFT_OUTPUT_POINTS
+#define FFT_OUTPUT_POINTS (WIDTH*HEIGHT - FFT_OUTPUT_FIRST)
+#endif
+#define FFT_PRUNE_INPUT (FFT_INPUT_POINTS < WIDTH*HEIGHT)
+#define FFT_PRUNE_OUTPUT (FFT_OUTPUT_FIRST > 0 || FFT_OUTPUT_POINTS < WIDTH*HEIGHT)
+/* point n = row*WIDTH + col of the input: rows [0, PRUNE_IN_ROWS) are live */
+#define PRUNE_IN_ROWS ((FFT_INPUT_POINTS + WIDTH - 1)/WIDTH)
+/* bin k = k1 + HEIGHT*k2 of the output: the rows k2 of the output
+ * [PRUNE_OUT_FIRST, PRUNE_OUT_LAST) are live */
+#define PRUNE_OUT_FIRST (FFT_OUTPUT_FIRST/HEIGHT)
+#define PRUNE_OUT_LAST ((FFT_OUTPUT_FIRST + FFT_OUTPUT_POINTS - 1)/HEIGHT + 1)
+
+/* band of the @p n rows of a matrix given to cluster @p c: the rows are
+ * split as evenly as possible, bands differ by one row at most */
+#define BAND_START(n, c) (((n)*(c))/NB_CLUSTER)
+#define BAND_SIZE(n, c) (BAND_START(n, (c)+1) - BAND_START(n, c))
 
-/* global matrix */
-#define WIDTH (TILE_WIDTH)
-#define HEIGHT (TILE_HEIGHT*NB_CLUSTER)
+/* tile of a cluster: up to HEIGHT/NB_CLUSTER rows (rounded up) of WIDTH points */
+#define TILE_WIDTH (WIDTH)
+#define TILE_HEIGHT ((HEIGHT + NB_CLUSTER - 1)/NB_CLUSTER)
+
+/* transposed tile: up to WIDTH/NB_CLUSTER rows (rounded up) of HEIGHT points */
+#define TILE_T_WIDTH (HEIGHT)
+#define TILE_T_HEIGHT ((WIDTH + NB_CLUSTER - 1)/NB_CLUSTER)
 
 /* tile buffer */
+#ifndef N
 #define N (1)
+#endif
+
+/* staging blocks of the in-place transpose (one per round in flight) */
+#define NB_STAGING (NB_CLUSTER > 2 ? 2 : 1)
+#define STAGING_SIZE (NB_CLUSTER > 1 ? (TILE_WIDTH/NB_CLUSTER)*TILE_HEIGHT : 1)
+
+/* cluster SMEM left to the tile buffers: 2 MB minus code, stacks and LUTs */
+#define SMEM_TILE_BUDGET (1536*1024)
+
+/* SMEM used by the resident filter spectrum */
+#if FFT_MODE == FFT_MODE_CONV
+#define SMEM_FILTER_FOOTPRINT (8*TILE_HEIGHT*TILE_WIDTH)
+#else
+#define SMEM_FILTER_FOOTPRINT (0)
+#endif
+
+/* SMEM used by the float tile of the output stage */
+#if FFT_OUTPUT != FFT_OUTPUT_COMPLEX
+#define SMEM_OUTPUT_FOOTPRINT (4*TILE_HEIGHT*TILE_WIDTH)
+#else
+#define SMEM_OUTPUT_FOOTPRINT (0)
+#endif
+
+/* SMEM used by the tile buffers (complex float: 8 bytes) */
+#ifdef FFT_INPLACE_TRANSPOSE
+#define SMEM_TILE_FOOTPRINT (8*(N*TILE_HEIGHT*TILE_WIDTH + NB_STAGING*STAGING_SIZE) + SMEM_FILTER_FOOTPRINT + SMEM_OUTPUT_FOOTPRINT)
+#define SMEM_TRANSPOSE_MODE "in-place"
+#else
+#define SMEM_TILE_FOOTPRINT (8*(2*N*TILE_HEIGHT*TILE_WIDTH) + SMEM_FILTER_FOOTPRINT + SMEM_OUTPUT_FOOTPRINT)
+#define SMEM_TRANSPOSE_MODE "out-of-place"
+#endif
+
+/* pipelined transposes (pipeline=1): the row FFTs send each row as soon as
+ * it is computed, the targets count the rows received per source cluster */
+#ifndef FFT_PIPELINE
+#define FFT_PIPELINE (0)
+#endif
 
 /* nb fft iteration */
 #define NB_FFT_ITER (500)
 
-#if !(NB_CLUSTER==1 || NB_CLUSTER==2 || NB_CLUSTER==4 || NB_CLUSTER==8 || NB_CLUSTER==16)
-#error "Please only 1, 2, 4, 8 or 16 cluster(s) implementations are supported\n"
+/* resident service (service=1) latency report: requests per load, arriving
+ * in bursts of FFT_SERVICE_BURST, at the loads FFT_SERVICE_LOADS (fraction of
+ * the throughput measured over FFT_SERVICE_WARMUP back-to-back requests) */
+#define FFT_SERVICE_WARMUP (8)
+#define FFT_SERVICE_REQUESTS (64)
+#ifndef FFT_SERVICE_BURST
+#define FFT_SERVICE_BURST (8)
+#endif
+#ifndef FFT_SERVICE_LOADS
+#define FFT_SERVICE_LOADS {0.25f, 0.5f, 0.9f}
+#endif
+
+/* host queue (host_queue=1): the pool leaves the host room for this many
+ * input and output buffer pairs of the largest size served */
+#ifndef FFT_HOST_POOL_PAIRS
+#define FFT_HOST_POOL_PAIRS (8)
+#endif
+
+/* nb fft iteration timed per candidate plan by the autotuner */
+#define NB_AUTOTUNE_ITER (20)
+
+/* microbenchmarks (bench=1): calls timed per point of the sweeps, largest
+ * row FFT, and the peaks of the roofline: single precision flop/cycle and
+ * shared memory bytes/cycle of a PE, DMA bytes/cycle of a cluster. Every
+ * fraction of peak and bound verdict depends on the peaks, so they have no
+ * default: take them from the documentation of the target chip */
+#define FFT_BENCH_ITER (20)
+#define FFT_BENCH_MIN_SIZE (16)
+#define FFT_BENCH_MAX_SIZE (1024)
+#if defined(FFT_MICROBENCH) && \
+    (!defined(FFT_BENCH_PEAK_FLOP) || !defined(FFT_BENCH_PEAK_SMEM) || !defined(FFT_BENCH_PEAK_DMA))
+#error "bench=1 needs the peaks of the target: peak_flop=, peak_smem= and peak_dma= at build time\n"
+#endif
+
+/* wisdom file read and updated by the IO */
+#ifndef FFT_WISDOM_FILE
+#define FFT_WISDOM_FILE "fft.wisdom"
+#endif
+
+#if (NB_CLUSTER<1 || NB_CLUSTER>16)
+#error "Please the number of cluster(s) must be in range [1,16]\n"
+#endif
+
+#if (WIDTH < NB_CLUSTER || HEIGHT < NB_CLUSTER)
+#error "Please WIDTH and HEIGHT must be at least NB_CLUSTER\n"
+#endif
+
+#if defined(FFT_INPLACE_TRANSPOSE) && (WIDTH != HEIGHT)
+#error "Please the in-place transpose only supports square matrices (WIDTH == HEIGHT)\n"
+#endif
+
+#if defined(FFT_INPLACE_TRANSPOSE) && (((NB_CLUSTER & (NB_CLUSTER-1)) != 0) || (WIDTH % NB_CLUSTER) != 0)
+#error "Please the in-place transpose pairs clusters: it needs 1, 2, 4, 8 or 16 clusters and equal bands\n"
+#endif
+
+#if FFT_FUSED_BITREVERSE && (FFT_DMA == FFT_DMA_ROW)
+#error "Please the fused bit-reversal gathers one column per DMA: use dma=column\n"
+#endif
+
+#if (FFT_OUTPUT != FFT_OUTPUT_COMPLEX) && (defined(FFT_INPLACE_TRANSPOSE) || FFT_MODE == FFT_MODE_CONV)
+#error "Please the output stage needs the out-of-place transpose and mode=forward or inverse\n"
+#endif
+
+#if (FFT_INPUT_POINTS < 1 || FFT_INPUT_POINTS > WIDTH*HEIGHT || FFT_OUTPUT_POINTS < 1 || \
+     FFT_OUTPUT_FIRST < 0 || FFT_OUTPUT_FIRST + FFT_OUTPUT_POINTS > WIDTH*HEIGHT)
+#error "Please the input points and the output bins must lie in [0, WIDTH*HEIGHT)\n"
+#endif
+
+#if FFT_PIPELINE && defined(FFT_INPLACE_TRANSPOSE)
+#error "Please the pipelined transposes need the out-of-place transpose\n"
+#endif
+
+#if (FFT_ORDER == FFT_ORDER_TRANSPOSED) && (FFT_MODE == FFT_MODE_CONV || FFT_PRUNE_OUTPUT)
+#error "Please the transposed output order needs mode=forward or inverse and no output pruning\n"
+#endif
+
+#if defined(FFT_SERVICE) && defined(FFT_GROUPS)
+#error "Please the resident service runs a single group\n"
+#endif
+
+#if defined(FFT_HOST_QUEUE) && (!defined(FFT_SERVICE) || FFT_MODE != FFT_MODE_FORWARD || \
+     FFT_WINDOW != FFT_WINDOW_NONE || FFT_OUTPUT != FFT_OUTPUT_COMPLEX || FFT_ORDER == FFT_ORDER_TRANSPOSED || \
+     FFT_PRUNE_INPUT || FFT_PRUNE_OUTPUT)
+#error "Please the host queue serves plain forward FFTs in natural order through the resident service\n"
+#endif
+
+#if defined(FFT_GROUPS) && (FFT_PRUNE_INPUT || FFT_PRUNE_OUTPUT)
+#error "Please the cluster groups run unpruned FFTs of their own size\n"
+#endif
+
+#if (FFT_PRUNE_INPUT || FFT_PRUNE_OUTPUT) && (defined(FFT_INPLACE_TRANSPOSE) || FFT_MODE == FFT_MODE_CONV)
+#error "Please the pruned FFT needs the out-of-place transpose and mode=forward or inverse\n"
+#endif
+
+#if (SMEM_TILE_FOOTPRINT > SMEM_TILE_BUDGET)
+#error "Please the tile buffers do not fit in cluster SMEM, reduce TILE or N (or use the in-place transpose)\n"
 #endif
 
 #if (N_CORES<=0 || N_CORES>16)
@@ -44,8 +44,115 @@ fft_radix2_get_bitreverse(int size);
 void
 fft_radix2_float(cplx_float_t * restrict in, const float *twiddle, const int *array_bit_reverse, const int size);
 
+/** @return the bit-reverse permutation of [0, size): out[i] = reverse(i) */
+int*
+fft_radix2_get_bitreverse_index(int size);
+
+/** number of entries (two per swap) of a fft_radix2_get_bitreverse() lut */
+int
+fft_radix2_get_bitreverse_count(const int *array_bit_reverse);
+
+/** apply the swaps [first, last) of the bit-reverse lut to @p in
+ *  (first and last are lut entry indices, hence even)
+ */
+void
+fft_radix2_float_bitreverse(cplx_float_t * restrict in, const int *array_bit_reverse, const int first, const int last);
+
+/** compute the butterflies [b_first, b_last) of every radix-2 stage of
+ *  span m_first to m_last (both powers of two) on bit-reversed data.
+ *  A stage holds size/2 butterflies, so disjoint butterfly ranges of the
+ *  same stages can run concurrently on several PEs.
+ */
+void
+fft_radix2_float_stages(cplx_float_t * restrict in, const float *twiddle, const int size,
+                        const int m_first, const int m_last, const int b_first, const int b_last);
+
+/** decimation in frequency counterpart of fft_radix2_float_stages():
+ *  stages of span m_first down to m_last on naturally ordered data.
+ */
+void
+fft_radix2_float_dif_stages(cplx_float_t * restrict in, const float *twiddle, const int size,
+                            const int m_first, const int m_last, const int b_first, const int b_last);
+
+/** decimation in frequency radix-2 FFT: natural order in, bit-reversed
+ *  order out (no permutation pass). Uses the fft_radix2_get_twiddle_float()
+ *  table.
+ */
+void
+fft_radix2_float_dif(cplx_float_t * restrict in, const float *twiddle, const int size);
+
+/* largest number of blocks combined by fft_radix2_float_pruned_out() */
+#define FFT_PRUNE_MAX_BLOCK (64)
+
+/** input-pruned fft_radix2_float_dif(): only the first @p live points of
+ *  @p in may be non-zero, the others are not read. The first log2(size/bs)
+ *  stages, bs being the smallest power of two >= @p live, reduce to one
+ *  twiddle product per point and are replaced by it.
+ */
+void
+fft_radix2_float_dif_pruned(cplx_float_t * restrict in, const float *twiddle, const int size, const int live);
+
+/** output-pruned fft_radix2_float(): natural order in and out, only the
+ *  bins [@p first, @p last) are computed, the others are left undefined.
+ *  The last stages are evaluated directly for the blocks holding these bins
+ *  when it saves operations.
+ */
+void
+fft_radix2_float_pruned_out(cplx_float_t * restrict in, const float *twiddle, const int *array_bit_reverse,
+                            const int size, const int first, const int last);
+
+/** factors exp(-2i.pi.k/(w.h)) of the twiddle correction for the rows k
+ *  of the band of the cluster of rank @p cid in its group
+ *  (BAND_START(h, cid), BAND_SIZE(h, cid))
+ */
 float*
-fft_get_correction_twiddle(int w, int h);
+fft_get_correction_twiddle(int w, int h, int cid);
+
+/* row FFT of any length */
+#define FFT_ROW_RADIX2    (0)	/* power of two: radix-2 tables and kernels */
+#define FFT_ROW_MIXED     (1)	/* 2^a.3^b.5^c.7^d: Stockham mixed-radix */
+#define FFT_ROW_BLUESTEIN (2)	/* other prime factors: Bluestein chirp-z */
+
+#define FFT_ROW_MAX_FACTOR (32)
+#define FFT_ROW_MAX_RADIX (7)
+
+typedef struct
+{
+	int size;
+	int kind;		/* FFT_ROW_* */
+	int work_size;		/* complex scratch points needed per PE by fft_row_execute() */
+	/* radix-2 tables (of bs_size points for Bluestein) */
+	float *twiddle;
+	int *lut;
+	int *rev;
+	/* mixed radix */
+	int nb_factor;
+	int factor[FFT_ROW_MAX_FACTOR];
+	cplx_float_t *stage_twiddle;
+	float root_cos[FFT_ROW_MAX_RADIX+1][FFT_ROW_MAX_RADIX];
+	float root_sin[FFT_ROW_MAX_RADIX+1][FFT_ROW_MAX_RADIX];
+	/* Bluestein */
+	int bs_size;
+	cplx_float_t *chirp;
+	cplx_float_t *filter;
+}fft_row_plan_t;
+
+/** precompute the tables of a forward FFT of @p size points
+ *  @param pow2_kind kernel of a power of two @p size: FFT_ROW_RADIX2 or
+ *                   FFT_ROW_MIXED (Stockham)
+ */
+fft_row_plan_t*
+fft_row_plan_create(int size, int pow2_kind);
+
+/** free a plan of fft_row_plan_create() and its tables */
+void
+fft_row_plan_destroy(fft_row_plan_t *plan);
+
+/** forward FFT of one row in place, @p work holds plan->work_size points
+ *  (unused by radix-2 plans)
+ */
+void
+fft_row_execute(const fft_row_plan_t *plan, cplx_float_t * restrict in, cplx_float_t * restrict work);
 
 #endif
 
@@ -0,0 +1,58 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Kalray S.A
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FFT_PLAN_H
+#define FFT_PLAN_H
+
+#include <stdint.h>
+
+/* row FFT kernel */
+#define FFT_KERNEL_RADIX2_DIT (0)	/* bit-reverse pass then DIT stages */
+#define FFT_KERNEL_RADIX2_DIF (1)	/* DIF stages, bit-reversal folded in the transpose */
+
+/* row FFT algorithm of the power of two sides (the other sides always use
+ * the Stockham mixed-radix or the Bluestein kernel) */
+#define FFT_RADIX_2     (0)	/* radix-2 tables and kernels */
+#define FFT_RADIX_MIXED (1)	/* Stockham mixed-radix, radix 4 and 2 stages */
+
+/* transpose DMA pattern */
+#define FFT_DMA_COLUMN (0)	/* one DMA per local column (strided read, contiguous write) */
+#define FFT_DMA_ROW    (1)	/* one DMA per local row block (contiguous read, strided write) */
+
+/* Runtime configuration of the clusters, exchanged with the IO in the
+ * PLAN_SEGMENT_ID segment. The other knobs (tile split, buffering depth,
+ * precision, cluster and core counts) are fixed at build time and are part
+ * of the wisdom signature.
+ */
+typedef struct
+{
+	int32_t valid;		/* plan set by wisdom or by a search */
+	int32_t searched;	/* plan found by the autotuner during this run */
+	int32_t kernel;		/* FFT_KERNEL_* */
+	int32_t radix;		/* FFT_RADIX_* */
+	int32_t pe_per_row;	/* PEs sharing one row FFT, 0 for automatic */
+	int32_t dma;		/* FFT_DMA_* */
+	float time_ms;		/* time per iteration measured by the search */
+}fft_plan_t;
+
+#endif
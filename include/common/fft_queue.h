@@ -0,0 +1,145 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Kalray S.A
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FFT_QUEUE_H
+#define FFT_QUEUE_H
+
+#include <stdint.h>
+
+/* Submission/completion rings between the host library (fft_host.h) and an
+ * FFT engine, in the window of the engine: on the board the IO serves them
+ * (FFT_HOST_QUEUE) and runs each request on the clusters, the host
+ * emulator of fft_host_emu.c serves the same window in shared memory.
+ * The host is the only producer of the submission ring and the only
+ * consumer of the completion ring, the engine does the opposite.
+ * Head and tail are free running counters, slot = counter % FFT_QUEUE_DEPTH.
+ */
+
+/* segment of the window in the DDR of the IO (FFT_HOST_QUEUE), above the
+ * segment ids of the cluster groups (config.h) */
+#define FFT_QUEUE_SEGMENT_ID (90)
+
+/* number of slots of each ring (power of two) */
+#define FFT_QUEUE_DEPTH (32)
+
+/* fft_queue_desc_t status */
+#define FFT_QUEUE_STATUS_OK       (0)
+#define FFT_QUEUE_STATUS_EINVAL   (-1)	/* unsupported size or bad buffer */
+#define FFT_QUEUE_STATUS_EIO      (-2)	/* output lost by the transport (host) */
+
+/* bytes of a complex float point */
+#define FFT_QUEUE_POINT_SIZE (8)
+
+/* fft_queue_window_t flags: constraints on the matrix of a request */
+#define FFT_QUEUE_SQUARE (1)	/* width == height, multiple of min_side */
+#define FFT_QUEUE_POW2   (2)	/* width and height powers of two */
+
+typedef struct
+{
+	uint64_t in_addr;	/* device address of the input samples */
+	uint64_t out_addr;	/* device address of the output samples */
+	uint32_t id;		/* request id, copied in the completion */
+	uint32_t size;		/* number of complex float points */
+	int32_t status;		/* completion status (FFT_QUEUE_STATUS_*) */
+	uint32_t reserved;
+}fft_queue_desc_t;
+
+typedef struct
+{
+	volatile uint32_t sq_head;	/* written by the engine */
+	volatile uint32_t sq_tail;	/* written by the host */
+	volatile uint32_t cq_head;	/* written by the host */
+	volatile uint32_t cq_tail;	/* written by the engine */
+	fft_queue_desc_t sq[FFT_QUEUE_DEPTH];
+	fft_queue_desc_t cq[FFT_QUEUE_DEPTH];
+}fft_queue_t;
+
+/* Window of an engine: the rings, the doorbell and the description of the
+ * sample pool and of the matrices the engine computes, set by the engine
+ * before ready. A device address is a byte offset in the sample pool, the
+ * host allocates its buffers in [pool_first, pool_size). The engine
+ * computes a request of size points as a width x height matrix, see
+ * fft_queue_split().
+ */
+typedef struct
+{
+	fft_queue_t queue;
+	long long doorbell;	/* rung by the host after moving sq_tail */
+	long long ready;	/* set by the engine once it serves the rings */
+	long long shutdown;	/* set by the host before its last doorbell */
+	long long pool_segment;	/* segment id of the pool (PCIe transport) */
+	long long pool_first;	/* first byte of the pool left to the host */
+	long long pool_size;	/* bytes of the pool */
+	long long min_side;	/* smallest width and height */
+	long long max_width;	/* largest width */
+	long long max_height;	/* largest height */
+	long long flags;	/* FFT_QUEUE_SQUARE, FFT_QUEUE_POW2 */
+}fft_queue_window_t;
+
+/** split an FFT of @p size points in the squarest matrix the engine of
+ *  @p window computes, width >= height
+ *  @return 0 on success, -1 if there is none
+ */
+static inline int
+fft_queue_split(const fft_queue_window_t *window, long long size, int *width, int *height)
+{
+	long long h;
+	int found = 0;
+	if ((window->flags & FFT_QUEUE_POW2) && (size & (size-1)) != 0)
+	{
+		return -1;
+	}
+	for (h = window->min_side; h*h <= size; h++)
+	{
+		long long w = size/h;
+		if (size % h != 0 || w > window->max_width || h > window->max_height)
+		{
+			continue;
+		}
+		if ((window->flags & FFT_QUEUE_SQUARE) && (w != h || w % window->min_side != 0))
+		{
+			continue;
+		}
+		*width = (int)w;
+		*height = (int)h;
+		found = 1;
+	}
+	return found ? 0 : -1;
+}
+
+/** @return 1 if the buffers of @p desc lie in the pool of @p window and are
+ *  aligned on a point, 0 otherwise
+ */
+static inline int
+fft_queue_desc_valid(const fft_queue_window_t *window, const fft_queue_desc_t *desc)
+{
+	const uint64_t bytes = (uint64_t)desc->size*FFT_QUEUE_POINT_SIZE;
+	const uint64_t first = (uint64_t)window->pool_first;
+	const uint64_t last = (uint64_t)window->pool_size;
+	return desc->size > 0 && bytes <= last - first &&
+	       desc->in_addr >= first && desc->in_addr <= last - bytes &&
+	       desc->out_addr >= first && desc->out_addr <= last - bytes &&
+	       desc->in_addr % FFT_QUEUE_POINT_SIZE == 0 && desc->out_addr % FFT_QUEUE_POINT_SIZE == 0;
+}
+
+#endif
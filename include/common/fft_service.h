@@ -0,0 +1,60 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Kalray S.A
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FFT_SERVICE_H
+#define FFT_SERVICE_H
+
+/* Command mailbox of the resident FFT service (FFT_SERVICE), in the DDR of
+ * the IO (MAILBOX_SEGMENT_ID). The IO writes the command, increases seq and
+ * rings the doorbell of every cluster of the group: it adds one to the
+ * counter at offset doorbell of their SMEM, on which each cluster waits
+ * (no polling of the DDR). Each cluster adds one to done when it is through
+ * with the command, the IO waits for seq*NB_CLUSTER. ready counts the
+ * clusters waiting for their first command, the first cluster publishes
+ * doorbell before. The IO sets the first matrix and its buffers before the
+ * spawn.
+ * The input and output buffers are byte offsets in the pool segment
+ * (MATRIX_SEGMENT_ID). The clusters serve any size their buffers, sized at
+ * build time, can hold; they reject the others (rejected) and go on.
+ */
+
+#define FFT_CMD_NONE     (0)
+#define FFT_CMD_EXECUTE  (1)	/* one FFT of the input buffer into the output buffer */
+#define FFT_CMD_RESIZE   (2)	/* rebuild the plans and LUTs for width x height */
+#define FFT_CMD_SHUTDOWN (3)	/* exit */
+
+typedef struct
+{
+	long long seq;		/* commands posted by the IO */
+	long long cmd;		/* FFT_CMD_* of command seq */
+	long long done;		/* commands completed, summed over the clusters */
+	long long ready;	/* clusters waiting for commands */
+	long long doorbell;	/* offset of the command counter in the cluster SMEM */
+	long long rejected;	/* commands of an invalid size, summed over the clusters */
+	long long in_offset;	/* EXECUTE: input matrix in the pool segment */
+	long long out_offset;	/* EXECUTE: output matrix in the pool segment */
+	long long width;	/* EXECUTE, RESIZE: matrix size, EXECUTE resizes first */
+	long long height;	/*   if it differs from the current one */
+}fft_mailbox_t;
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Kalray S.A
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FFT_VECTORS_H
+#define FFT_VECTORS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Binary test-vector file: a fft_vectors_header_t, the width*height input
+ * points, then nb_reference records, each a fft_vectors_record_t followed by
+ * the width*height points of a reference output, all complex float in
+ * natural order. The key of a record hashes the input with everything its
+ * reference depends on (size, mode, window, filter): a build reuses the
+ * record of its key and otherwise adds one, so builds alternating their
+ * options (forward/inverse, window on/off) all keep their reference. Once
+ * the file holds FFT_VECTORS_MAX_REFERENCE records, the oldest one
+ * (next_reference) is replaced.
+ */
+
+#define FFT_VECTORS_MAGIC   (0x56544646u)	/* "FFTV" */
+#define FFT_VECTORS_VERSION (2)
+#define FFT_VECTORS_MAX_REFERENCE (8)
+
+/* seed of fft_vectors_hash() */
+#define FFT_VECTORS_HASH_SEED (0xcbf29ce484222325ull)
+
+typedef struct
+{
+	uint32_t magic;		/* FFT_VECTORS_MAGIC */
+	uint32_t version;	/* FFT_VECTORS_VERSION */
+	int32_t width;		/* matrix of the transform */
+	int32_t height;
+	int32_t nb_reference;	/* records following the input */
+	int32_t next_reference;	/* record replaced when the file is full */
+	uint32_t reserved[10];
+}fft_vectors_header_t;
+
+typedef struct
+{
+	uint64_t key;		/* reference key, see above */
+	float rel_threshold;	/* tolerance relative to the peak of the reference */
+	uint32_t reserved[5];
+}fft_vectors_record_t;
+
+/** offset in the file of the record @p i of a @p points point matrix */
+static inline size_t
+fft_vectors_record_offset(int points, int i)
+{
+	return sizeof(fft_vectors_header_t) + 8*(size_t)points +
+	       (size_t)i*(sizeof(fft_vectors_record_t) + 8*(size_t)points);
+}
+
+/** FNV-1a hash of @p size bytes of @p data, chained from @p hash
+ *  (FFT_VECTORS_HASH_SEED for the first block)
+ */
+static inline uint64_t
+fft_vectors_hash(const void *data, size_t size, uint64_t hash)
+{
+	const uint8_t *p = data;
+	size_t i;
+	for (i = 0; i < size; i++)
+	{
+		hash = (hash ^ p[i])*0x100000001b3ull;
+	}
+	return hash;
+}
+
+/** key of the reference of the @p width x @p height points of @p input,
+ *  computed for @p mode and @p window (FFT_MODE_*, FFT_WINDOW_*), with
+ *  @p correlate and the @p nb_taps taps of the filter in FFT_MODE_CONV
+ */
+static inline uint64_t
+fft_vectors_key(const void *input, int32_t width, int32_t height, int32_t mode, int32_t window,
+                int32_t correlate, const float *taps, int nb_taps)
+{
+	const int32_t desc[] = {width, height, mode, window, correlate};
+	uint64_t key = fft_vectors_hash(desc, sizeof(desc), FFT_VECTORS_HASH_SEED);
+	key = fft_vectors_hash(input, 8*(size_t)width*height, key);
+	return fft_vectors_hash(taps, sizeof(float)*nb_taps, key);
+}
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Kalray S.A
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FFT_HOST_H
+#define FFT_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fft_kernels.h"
+#include "fft_queue.h"
+
+/* Asynchronous host-side FFT interface.
+ *
+ * The rings and the sample pool of the engine live in its window
+ * (fft_queue_window_t): on the board, in the DDR of the IO, which serves
+ * the rings and runs each request on the clusters (fft_host_transport_pcie,
+ * host_queue=1). fft_host_transport_emu serves the same window from a host
+ * thread in shared memory, so that the library runs without a board.
+ *
+ * Buffers are registered once with fft_host_register(), which reserves
+ * their mirror in the pool, and then reused by any number of requests: a
+ * request carries the device addresses of its input and output.
+ * fft_host_submit() copies the input to its mirror and returns as soon as
+ * the request is queued, fft_host_poll() or fft_host_wait() copy the output
+ * back with its completion.
+ *
+ * A fft_host_t is not thread-safe: submit and poll/wait must be called from
+ * the same thread (or be serialized by the caller).
+ */
+
+typedef struct fft_host fft_host_t;
+
+typedef struct
+{
+	int id;		/* value returned by fft_host_submit() */
+	int status;	/* FFT_QUEUE_STATUS_* */
+	void *user;	/* user pointer given to fft_host_submit() */
+}fft_host_completion_t;
+
+/** access to the window of an engine. Offsets are bytes in the window
+ *  (fft_queue_window_t), device addresses bytes in the sample pool.
+ */
+typedef struct
+{
+	const char *name;
+	/** reach the engine of @p arg (transport specific) and wait until it
+	 *  serves its window */
+	int (*open)(void **ctx, void *arg);
+	void (*close)(void *ctx);
+	/** copy @p size bytes between @p buf and the window at @p offset */
+	int (*read)(void *ctx, size_t offset, void *buf, size_t size);
+	int (*write)(void *ctx, size_t offset, const void *buf, size_t size);
+	/** copy @p size bytes between @p buf and the pool at @p addr */
+	int (*pool_read)(void *ctx, uint64_t addr, void *buf, size_t size);
+	int (*pool_write)(void *ctx, uint64_t addr, const void *buf, size_t size);
+	/** ring the doorbell of the window, after a write of sq_tail */
+	void (*doorbell)(void *ctx);
+	/** block until the engine may have posted a completion (may return
+	 *  spuriously) */
+	void (*wait_irq)(void *ctx);
+}fft_host_transport_t;
+
+/* board behind PCIe, arg is the mppadesc_t* of the booted board, see
+ * fft_host_pcie.c */
+extern const fft_host_transport_t fft_host_transport_pcie;
+/* host thread standing in for the IO and the clusters, arg is unused, see
+ * fft_host_emu.c */
+extern const fft_host_transport_t fft_host_transport_emu;
+
+/** open the engine of @p arg through @p transport
+ *  @return NULL on error
+ */
+fft_host_t*
+fft_host_open(const fft_host_transport_t *transport, void *arg);
+
+/** wait for the outstanding requests, unregister every buffer, stop the
+ *  engine and release @p host
+ */
+void
+fft_host_close(fft_host_t *host);
+
+/** reserve the mirror of @p buf of @p size bytes in the pool so that it
+ *  can be used by requests
+ *  @return 0 on success, -1 otherwise
+ */
+int
+fft_host_register(fft_host_t *host, void *buf, size_t size);
+
+/** release the mirror of a buffer registered with fft_host_register()
+ *  @return 0 on success, -1 if @p buf is not registered
+ */
+int
+fft_host_unregister(fft_host_t *host, void *buf);
+
+/** queue a forward FFT of @p size points from @p in to @p out. Both buffers
+ *  must lie in registered buffers and stay untouched until completion.
+ *  @return the request id (>= 0), -1 if the buffers are not registered,
+ *          -2 if the submission ring is full, -3 if the engine does not
+ *          support @p size, -4 if the transport failed
+ */
+int
+fft_host_submit(fft_host_t *host, const cplx_float_t *in, cplx_float_t *out,
+                int size, void *user);
+
+/** retrieve one completion without blocking, the output of a completed
+ *  request is back in its buffer
+ *  @return 1 if @p c was filled, 0 if no request completed
+ */
+int
+fft_host_poll(fft_host_t *host, fft_host_completion_t *c);
+
+/** retrieve one completion, blocking until a request completes
+ *  @return 1 if @p c was filled, 0 if no request is outstanding
+ */
+int
+fft_host_wait(fft_host_t *host, fft_host_completion_t *c);
+
+/** @return the number of submitted requests not yet retrieved */
+int
+fft_host_pending(const fft_host_t *host);
+
+#endif
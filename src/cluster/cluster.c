@@ -36,21 +36,151 @@
 #include <mppa_remote.h>
 #include <vbsp.h>
 #include <string.h>
+#include <stddef.h>
 #include <assert.h>
 #include "config.h"
 #include "fft_kernels.h"
+#include "fft_plan.h"
+#include "fft_service.h"
 
 #define min(a,b) (a<b?a:b)
+#define max(a,b) (a>b?a:b)
 
 static long long go = 0;
 static off64_t go_offset = 0;
+/* cluster group (FFT_GROUPS of the IO): this binary runs on the NB_CLUSTER
+ * clusters from group_first, group_rank is the rank of this cluster in it */
+static int group_id = 0;
+static int group_first = 0;
+static int group_rank = 0;
+#define GROUP_CLUSTER(rank) (group_first + (rank))
+/* group barrier: each cluster adds one to barrier_count on every cluster
+ * of the group, barrier_epoch barriers are done */
+static long long barrier_count = 0;
+static long long barrier_epoch = 0;
+static off64_t barrier_offset = 0;
+/* pipelined transposes (FFT_PIPELINE): block_count[s] counts the rows
+ * received from the cluster of rank s */
+static long long block_count[NB_CLUSTER] __attribute__((aligned(8)));
+static off64_t block_offset = 0;
+/* band of rows of this cluster: tile_height rows from tile_row (up to
+ * TILE_HEIGHT), the transposed tiles hold tile_t_height rows from tile_t_row */
+static int tile_row = 0;
+static int tile_height = TILE_HEIGHT;
+static int tile_t_row = 0;
+static int tile_t_height = TILE_T_HEIGHT;
+/* pruned FFT: the first tile_live_height rows of the band are live input
+ * rows, the tile_t_live_height rows from tile_t_live_row are output rows */
+static int tile_live_height = TILE_HEIGHT;
+static int tile_t_live_row = 0;
+static int tile_t_live_height = TILE_T_HEIGHT;
 static cplx_float_t submatrix_a[N][TILE_HEIGHT][TILE_WIDTH] __attribute__((aligned(64)));
-static cplx_float_t submatrix_b[N][TILE_HEIGHT][TILE_WIDTH] __attribute__((aligned(64)));
-static int *lut = NULL;
-static float *twiddle = NULL;
+#ifdef FFT_INPLACE_TRANSPOSE
+/* the transposes work in place: one tile per buffer plus the staging blocks */
+static cplx_float_t staging[NB_STAGING][STAGING_SIZE] __attribute__((aligned(64)));
+static long long inplace_ready[NB_CLUSTER];
+static long long inplace_arrived[NB_CLUSTER];
+static long long inplace_epoch = 0;
+#define TILE_B(buffer) (submatrix_a[buffer])
+#else
+/* transposed tiles: up to TILE_T_HEIGHT rows of HEIGHT points */
+static cplx_float_t submatrix_b[N][TILE_T_HEIGHT][TILE_T_WIDTH] __attribute__((aligned(64)));
+#define TILE_B(buffer) (submatrix_b[buffer])
+#endif
+#if FFT_OUTPUT != FFT_OUTPUT_COMPLEX
+/* output stage of the last row FFTs, floats */
+static float output_tile[TILE_HEIGHT][TILE_WIDTH] __attribute__((aligned(64)));
+#define OUTPUT_TILE (&output_tile[0][0])
+#else
+#define OUTPUT_TILE (NULL)
+#endif
+/* pointwise stages and pruning of a pass of ffts() */
+#define FFT_PASS_WINDOW    (1)	/* window the input (FFT_WINDOW) */
+#define FFT_PASS_PRUNE_IN  (2)	/* rows of HEIGHT points of the input, zero padded (FFT_INPUT_POINTS) */
+#define FFT_PASS_PRUNE_OUT (4)	/* rows of WIDTH points of the output, bins of the rows [PRUNE_OUT_FIRST, PRUNE_OUT_LAST) only */
+/* passes of the forward 6-step reading the input and writing the output */
+#define FFT_PASS_INPUT ((FFT_WINDOW != FFT_WINDOW_NONE ? FFT_PASS_WINDOW : 0) | (FFT_PRUNE_INPUT ? FFT_PASS_PRUNE_IN : 0))
+#define FFT_PASS_OUTPUT (FFT_PRUNE_OUTPUT ? FFT_PASS_PRUNE_OUT : 0)
+/* FFTs of the columns (HEIGHT points) and of the rows (WIDTH points) */
+static fft_row_plan_t *col_plan = NULL;
+static fft_row_plan_t *row_plan = NULL;
 static float *correction_twiddle_coef = NULL;
+#if FFT_MODE == FFT_MODE_CONV
+/* twiddle correction of the inverse pass, on the transposed tiles */
+static float *correction_twiddle_coef_t = NULL;
+/* filter spectrum, kept in SMEM across calls. FILTER_TRANSPOSED: element
+ * [i][k2] is H[k1 + HEIGHT*k2] (k1 = tile_row + i), the layout of the
+ * forward spectrum before its last transpose. FILTER_NATURAL: the tile rows
+ * of the spectrum in natural order. */
+#define FILTER_TRANSPOSED (0)
+#define FILTER_NATURAL (1)
+static cplx_float_t filter[TILE_HEIGHT][TILE_WIDTH] __attribute__((aligned(64)));
+static int filter_layout = -1;
+/* fused (1) or unfused (0) convolution timed by fft_iterations() */
+static int conv_fused = 1;
+#endif
 static int nb_job_dma = 0;
+#ifdef FFT_SERVICE
+/* resident service: the buffers above are sized for the largest matrix of
+ * the build (WIDTH x HEIGHT), the matrix served is set by the IO (mailbox)
+ * and changed in place by FFT_CMD_RESIZE */
+static const int service_max_width = WIDTH;
+static const int service_max_height = HEIGHT;
+static int service_width = WIDTH;
+static int service_height = HEIGHT;
+#undef WIDTH
+#undef HEIGHT
+#define WIDTH (service_width)
+#define HEIGHT (service_height)
+#endif
 
+#ifndef FFT_FUSED_BITREVERSE
+#define FFT_FUSED_BITREVERSE (0)
+#endif
+#ifndef PE_PER_ROW
+#define PE_PER_ROW (0)
+#endif
+#ifndef FFT_DMA
+#define FFT_DMA (FFT_DMA_COLUMN)
+#endif
+#ifndef FFT_RADIX
+#define FFT_RADIX (FFT_RADIX_2)
+#endif
+/* build time defaults, replaced by the wisdom or the autotuner plan.
+ * FFT_KERNEL_RADIX2_DIF: row FFTs leave their output in bit-reversed order
+ * and the transposes gather the columns in natural order */
+static const char *row_kind_name[] = {"radix2", "mixed", "bluestein"};
+static const char *fft_mode_name[] = {"forward", "inverse", "conv"};
+static const char *fft_window_name[] = {"none", "hann", "hamming", "blackman"};
+static const char *fft_output_name[] = {"complex", "power", "magnitude", "db"};
+static const char *fft_order_name[] = {"natural", "transposed"};
+
+static const fft_plan_t plan_default =
+{
+	.valid = 0,
+	.searched = 0,
+	.kernel = FFT_FUSED_BITREVERSE ? FFT_KERNEL_RADIX2_DIF : FFT_KERNEL_RADIX2_DIT,
+	.radix = FFT_RADIX,
+	.pe_per_row = PE_PER_ROW,
+	.dma = FFT_DMA,
+};
+static fft_plan_t plan;
+
+
+/** barrier of the clusters of the group, mppa_rpc_barrier_all() spans
+ *  every cluster of the chip
+ */
+static void
+group_barrier(void)
+{
+	int i;
+	barrier_epoch++;
+	for(i=0;i<NB_CLUSTER;i++)
+	{
+		mppa_async_postadd(mppa_async_default_segment(GROUP_CLUSTER(i)), barrier_offset, 1);
+	}
+	mppa_async_evalcond(&barrier_count, barrier_epoch*NB_CLUSTER, MPPA_ASYNC_COND_GE, NULL);
+}
 
 /** utility function to dump a complex float sub-matrix of size
  *  @p width x @p height
@@ -60,12 +190,12 @@ static int nb_job_dma = 0;
  */
 void dump_submatrix(cplx_float_t *m, int width, int height)
 {
-	mppa_rpc_barrier_all();
+	group_barrier();
 	int i;
-	int cid = __k1_get_cluster_id();
+	int cid = group_rank;
 	for(i=0;i<cid;i++)
 	{
-		mppa_rpc_barrier_all();
+		group_barrier();
 	}
 	printf("# Cluster %d Dump mat %p\n", cid, m);
 	for (i = 0; i < height; i++)
@@ -81,91 +211,657 @@ void dump_submatrix(cplx_float_t *m, int width, int height)
 	printf("\n");
 	for(i=cid;i<NB_CLUSTER;i++)
 	{
-		mppa_rpc_barrier_all();
+		group_barrier();
 	}
-	mppa_rpc_barrier_all();
+	group_barrier();
 }
 
-/**
- *
+/** local block of a transpose: the @p src_h rows of @p local (rows
+ *  @p src_row.. of a matrix of @p height rows of @p width points, the
+ *  columns gathered through @p col_lut if not NULL) go to the columns
+ *  src_row.. of the rows [@p x_first, @p x_last) of @p target, the band of
+ *  rows from @p dst_row of the transposed matrix
+ */
+static void
+transpose_block(const void *local, void *target, int height, int width, const int *col_lut, size_t esize,
+                int src_row, int src_h, int dst_row, int x_first, int x_last)
+{
+	int x, y;
+	for (y = 0; y < src_h; y++)
+	{
+		for (x = x_first; x < x_last; x++)
+		{
+			int col = dst_row + x;
+			if (esize == sizeof(cplx_float_t))
+			{
+				((cplx_float_t*)target)[x*height + src_row + y] = ((const cplx_float_t*)local)[y*width + (col_lut ? col_lut[col] : col)];
+			}else
+			{
+				((float*)target)[x*height + src_row + y] = ((const float*)local)[y*width + (col_lut ? col_lut[col] : col)];
+			}
+		}
+	}
+}
+
+/** distributed transpose of the tiles @p local into the tiles @p target.
+ *  The source matrix has @p height rows of @p width points, cluster c holds
+ *  its rows [BAND_START(height, c), BAND_START(height, c+1)) and receives
+ *  the rows [BAND_START(width, c), BAND_START(width, c+1)) of the transposed
+ *  matrix. The bands of two clusters differ by one row at most.
+ *  @param col_lut if not NULL, column c of the transposed matrix is read from
+ *                 column col_lut[c] of @p local (e.g. bit-reversed rows),
+ *                 requires FFT_DMA_COLUMN
+ *  @param dma FFT_DMA_COLUMN: each DMA gathers one column of @p local into one
+ *             row of the target tile, FFT_DMA_ROW: each DMA scatters one row
+ *             block of @p local into one column of the target tile
+ *  @param esize size of the elements: complex float or float (output stage)
+ *  @param src_rows the rows of the source matrix from @p src_rows on are zero
+ *                  and not sent (pruned FFT), @p height for all
+ *  @param dst_first, dst_last only the rows [dst_first, dst_last) of the
+ *                  transposed matrix are sent (pruned FFT), 0 and @p width
+ *                  for all; the other rows of the target tiles are left as is
  * @return 0 on success, non-zero error code otherwise
  */
 int
-flat_transpose(void* local, void *target)
+flat_transpose(void* local, void *target, int height, int width, const int *col_lut, int dma, size_t esize,
+               int src_rows, int dst_first, int dst_last)
 {
-	cplx_float_t (*sub_local_a)[TILE_WIDTH] = local;
-	cplx_float_t (*sub_local_b)[TILE_WIDTH] = target;
 	off64_t offset;
-	int cid = __k1_get_cluster_id();
-	mppa_async_offset(mppa_async_default_segment(0), (void*)target, &offset);
+	int cid = group_rank;
+	const int src_row = BAND_START(height, cid);
+	const int src_h = max(0, min(BAND_SIZE(height, cid), src_rows - src_row));
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), (void*)target, &offset);
 	mppa_async_event_t evt;
+	int nb_dma = 0;
 	int i;
 	for(i=cid;i<NB_CLUSTER+cid;i++)
 	{
 		int target_cid = i%NB_CLUSTER;
-		if(i != cid)
+		/* live rows [dst_row, dst_row+dst_h) of the target band, row dst_skip of its tile */
+		int dst_row = max(BAND_START(width, target_cid), dst_first);
+		int dst_h = min(BAND_START(width, target_cid+1), dst_last) - dst_row;
+		int dst_skip = dst_row - BAND_START(width, target_cid);
+		if (src_h <= 0 || dst_h <= 0)
+		{
+			continue;
+		}
+		if(i != cid && dma == FFT_DMA_ROW)
+		{
+			int y;
+			for(y=0;y<src_h;y++)
+			{
+				void* local_addr = local + \
+						 esize * \
+						 (width*y + dst_row);
+				off64_t remote_addr =  offset + \
+					 esize * (src_row + y + height*dst_skip);
+				if(mppa_async_sput_spaced(local_addr,
+						mppa_async_default_segment(GROUP_CLUSTER(target_cid)),
+						remote_addr,
+						esize, dst_h,
+						esize,
+						esize*height, &evt) != 0)
+				{
+					printf("mppa_async_sput_spaced cid %d failed\n", cid);
+					return -1;
+				}
+				nb_job_dma++;
+				nb_dma++;
+			}
+		}else if(i != cid)
 		{
 			int j;
-			for(j=0;j<TILE_HEIGHT;j++)
+			for(j=0;j<dst_h;j++)
 			{
-				void* local_addr = ((void*)sub_local_a) + \
-						 sizeof(submatrix_a[0][0][0]) * \
-						 TILE_WIDTH/NB_CLUSTER*target_cid
-						 + sizeof(submatrix_a[0][0][0])*j;
+				int col = dst_row + j;
+				void* local_addr = local + \
+						 esize * \
+						 (col_lut ? col_lut[col] : col);
 				off64_t remote_addr =  offset + \
-					 sizeof(submatrix_a[0][0][0]) * TILE_WIDTH / NB_CLUSTER*cid\
-					 + sizeof(submatrix_a[0][0][0])*TILE_WIDTH*j;
+					 esize * src_row\
+					 + esize*height*(dst_skip + j);
 				if(mppa_async_sput_spaced(local_addr,
-						mppa_async_default_segment(target_cid),
+						mppa_async_default_segment(GROUP_CLUSTER(target_cid)),
 						remote_addr,
-						sizeof(submatrix_a[0][0][0]), TILE_WIDTH/NB_CLUSTER,
-						sizeof(submatrix_a[0][0][0])*TILE_WIDTH,
-						sizeof(submatrix_a[0][0][0]), &evt) != 0)
+						esize, src_h,
+						esize*width,
+						esize, &evt) != 0)
 				{
 					printf("mppa_async_sput_spaced cid %d failed\n", cid);
 					return -1;
 				}
 				nb_job_dma++;
+				nb_dma++;
 			}
 		}
 	}
-	int x, y;
-	i = cid;
-	for (y = 0; y < TILE_HEIGHT; y++)
+	const int dst_row = BAND_START(width, cid);
+	transpose_block(local, target, height, width, col_lut, esize, src_row, src_h, dst_row,
+	                max(0, dst_first - dst_row), min(BAND_SIZE(width, cid), dst_last - dst_row));
+	for(i=0;i<NB_CLUSTER;i++)
 	{
-		for (x = 0; x < TILE_WIDTH/NB_CLUSTER; x++)
-		{
-			sub_local_b[x][TILE_WIDTH/NB_CLUSTER*i + y] = sub_local_a[y][TILE_WIDTH/NB_CLUSTER*i + x];
-		}
+		mppa_async_postadd(mppa_async_default_segment(GROUP_CLUSTER(i)), go_offset, 1);
 	}
-	for(i=0;i<NB_CLUSTER;i++)
+	if(nb_dma > 0)
 	{
-		mppa_async_postadd(mppa_async_default_segment(i), go_offset, 1);
+		mppa_async_event_wait(&evt);
 	}
-	mppa_async_event_wait(&evt);
 	mppa_async_evalcond(&go, NB_CLUSTER, MPPA_ASYNC_COND_GE, NULL);
 	__builtin_k1_afdau(&go, -NB_CLUSTER);
 
 	return 0;
 }
 
+#ifdef FFT_INPLACE_TRANSPOSE
+/** in-place distributed transpose of the tiles @p local.
+ *  Clusters exchange their blocks pairwise, the partner of round r being
+ *  cid^r. The block for the partner is packed, already transposed, in a
+ *  staging buffer, which frees its place in the tile for the block coming
+ *  from the partner, and is sent with a single DMA. Two staging buffers
+ *  let the packing of a round overlap the DMA of the previous one. The
+ *  diagonal block is square and is transposed locally by swapping elements
+ *  (cycles of length two).
+ * @return 0 on success, non-zero error code otherwise
+ */
+int
+flat_transpose_inplace(void *local)
+{
+	cplx_float_t (*tile)[TILE_WIDTH] = local;
+	const int bw = TILE_WIDTH/NB_CLUSTER;
+	int cid = group_rank;
+	off64_t offset, ready_offset, arrived_offset;
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), local, &offset);
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), inplace_ready, &ready_offset);
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), inplace_arrived, &arrived_offset);
+	mppa_async_event_t evt[2];
+	int r, x, y;
+	inplace_epoch++;
+	for(r=1;r<=NB_CLUSTER;r++)
+	{
+		if(r<NB_CLUSTER)
+		{
+			int p = cid ^ r;
+			cplx_float_t *st = staging[r%NB_STAGING];
+			/* this staging buffer was sent at round r-2, completed at round r-1 */
+			for (x = 0; x < bw; x++)
+			{
+				for (y = 0; y < TILE_HEIGHT; y++)
+				{
+					st[x*TILE_HEIGHT + y] = tile[y][bw*p + x];
+				}
+			}
+			__builtin_k1_wpurge();
+			__builtin_k1_fence();
+			/* block p of the tile may now be overwritten by the partner */
+			mppa_async_postadd(mppa_async_default_segment(GROUP_CLUSTER(p)), ready_offset + sizeof(inplace_ready[0])*r, 1);
+		}
+		if(r>1)
+		{
+			/* complete the previous round */
+			int q = r-1;
+			mppa_async_event_wait(&evt[q%NB_STAGING]);
+			mppa_async_postadd(mppa_async_default_segment(GROUP_CLUSTER(cid ^ q)), arrived_offset + sizeof(inplace_arrived[0])*q, 1);
+		}
+		if(r<NB_CLUSTER)
+		{
+			int p = cid ^ r;
+			mppa_async_evalcond(&inplace_ready[r], inplace_epoch, MPPA_ASYNC_COND_GE, NULL);
+			if(mppa_async_put_spaced(staging[r%NB_STAGING], mppa_async_default_segment(GROUP_CLUSTER(p)),
+					offset + sizeof(submatrix_a[0][0][0])*bw*cid,
+					sizeof(submatrix_a[0][0][0])*TILE_HEIGHT, bw,
+					sizeof(submatrix_a[0][0][0])*TILE_WIDTH, &evt[r%NB_STAGING]) != 0)
+			{
+				printf("mppa_async_put_spaced cid %d failed\n", cid);
+				return -1;
+			}
+			nb_job_dma++;
+		}
+	}
+	for (y = 0; y < TILE_HEIGHT; y++)
+	{
+		for (x = y+1; x < bw; x++)
+		{
+			uint64_t dword = tile[y][bw*cid + x].dword;
+			tile[y][bw*cid + x].dword = tile[x][bw*cid + y].dword;
+			tile[x][bw*cid + y].dword = dword;
+		}
+	}
+	for(r=1;r<NB_CLUSTER;r++)
+	{
+		mppa_async_evalcond(&inplace_arrived[r], inplace_epoch, MPPA_ASYNC_COND_GE, NULL);
+	}
+	return 0;
+}
+#endif
+
+/** transpose the tiles @p local of a @p height x @p width matrix into
+ *  @p target, or in place in @p local for FFT_INPLACE_TRANSPOSE builds
+ *  (square matrix and equal bands only)
+ */
+static int
+transpose(void *local, void *target, int height, int width, const int *col_lut)
+{
+#ifdef FFT_INPLACE_TRANSPOSE
+	return flat_transpose_inplace(local);
+#else
+	return flat_transpose(local, target, height, width, col_lut, plan.dma, sizeof(cplx_float_t), height, 0, width);
+#endif
+}
+
+/* rows going out of ffts() to the transposed matrix (pipelined transposes) */
+typedef struct{
+	void *target;		/* target tiles */
+	off64_t offset;		/* offset of the target tiles in the default segments */
+	int height;		/* rows of the source matrix */
+	int width;		/* points of a row of the source matrix */
+	size_t esize;		/* complex float or float (output stage) */
+	int dst_first;		/* only the rows [dst_first, dst_last) of the */
+	int dst_last;		/* transposed matrix are sent */
+}row_send_t;
+
+/** live rows [*@p dst_row, *@p dst_row + return value) of the band of the
+ *  transposed matrix held by the cluster of rank @p t
+ */
+static int
+row_send_band(const row_send_t *send, int t, int *dst_row)
+{
+	*dst_row = max(BAND_START(send->width, t), send->dst_first);
+	return min(BAND_START(send->width, t+1), send->dst_last) - *dst_row;
+}
+
+/** send the row @p y of the source matrix, @p local, to the clusters of
+ *  rank t = @p pe mod @p nb_pe: one DMA per remote cluster (FFT_DMA_ROW
+ *  pattern), the block of this cluster is copied
+ *  @return the number of DMAs issued, -1 on error
+ */
+static int
+row_send(const row_send_t *send, const void *local, int y, int pe, int nb_pe, mppa_async_event_t *evt)
+{
+	int nb_dma = 0;
+	int t;
+	for (t = pe; t < NB_CLUSTER; t += nb_pe)
+	{
+		int dst_row;
+		int dst_h = row_send_band(send, t, &dst_row);
+		int dst_skip = dst_row - BAND_START(send->width, t);
+		if (dst_h <= 0)
+		{
+			continue;
+		}
+		if (t == group_rank)
+		{
+			transpose_block(local, send->target, send->height, send->width, NULL, send->esize,
+			                y, 1, BAND_START(send->width, t), dst_skip, dst_skip + dst_h);
+			continue;
+		}
+		if(mppa_async_sput_spaced(local + send->esize*dst_row,
+				mppa_async_default_segment(GROUP_CLUSTER(t)),
+				send->offset + send->esize*(y + send->height*dst_skip),
+				send->esize, dst_h,
+				send->esize,
+				send->esize*send->height, evt) != 0)
+		{
+			printf("mppa_async_sput_spaced cid %d failed\n", group_rank);
+			return -1;
+		}
+		nb_dma++;
+	}
+	return nb_dma;
+}
+
+/** tell the clusters of rank t = @p pe mod @p nb_pe that one more row
+ *  (sent by row_send() and complete) arrived
+ */
+static void
+row_send_signal(const row_send_t *send, int pe, int nb_pe)
+{
+	int t;
+	for (t = pe; t < NB_CLUSTER; t += nb_pe)
+	{
+		int dst_row;
+		if (t != group_rank && row_send_band(send, t, &dst_row) > 0)
+		{
+			mppa_async_postadd(mppa_async_default_segment(GROUP_CLUSTER(t)),
+			                   block_offset + group_rank*sizeof(block_count[0]), 1);
+		}
+	}
+}
+
+/** rows of the pipelined transpose of a @p height x @p width matrix into
+ *  the tiles @p target, see flat_transpose() for the other parameters
+ */
+static row_send_t
+row_send_init(void *target, int height, int width, size_t esize, int dst_first, int dst_last)
+{
+	row_send_t send = {target, 0, height, width, esize, dst_first, dst_last};
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), target, &send.offset);
+	return send;
+}
+
+/** wait for the rows sent by the other clusters of the group with
+ *  row_send(): all the rows of their band of the source matrix
+ */
+static void
+row_send_receive(const row_send_t *send)
+{
+	int dst_row;
+	int s;
+	if (row_send_band(send, group_rank, &dst_row) <= 0)
+	{
+		return;
+	}
+	for (s = 0; s < NB_CLUSTER; s++)
+	{
+		long long rows = BAND_SIZE(send->height, s);
+		if (s == group_rank || rows <= 0)
+		{
+			continue;
+		}
+		mppa_async_evalcond(&block_count[s], rows, MPPA_ASYNC_COND_GE, NULL);
+		__builtin_k1_afdau(&block_count[s], -rows);
+	}
+}
+
 typedef struct{
 	cplx_float_t * restrict in;
+	const fft_row_plan_t *row_plan;
+	cplx_float_t *work;	/* scratch of row_plan->work_size points */
 	float *twiddle;
 	int *array_bit_reverse;
 	int size;
 	int height;
+	int dif;		/* decimation in frequency, bit-reversed output */
+	int conj;		/* FFT_CONJ_* */
+	int row;		/* global index of the first row */
+	int pass;		/* FFT_PASS_* */
+	float *out;		/* output stage (FFT_OUTPUT) rows, NULL: complex output */
+	int pe;			/* rank of the PE among the PEs sharing a row */
+	int nb_pe;		/* number of PEs sharing a row */
+	long long *sync;	/* barrier counter of the row group */
+	const row_send_t *send;	/* if not NULL, rows sent to the transposed matrix */
+	mppa_async_event_t evt;	/* DMAs of the last row sent */
+	int pending;		/* DMAs of the last row sent, not signalled yet */
+	int nb_dma;
+	int err;
 }ffts_t;
 
+/* conjugation around the row FFTs, an inverse FFT being
+ * conj(FFT(conj(x)))/n: the input of the first pass and the output of the
+ * last one are conjugated, the latter is also scaled by 1/(WIDTH*HEIGHT) */
+#define FFT_CONJ_NONE (0)
+#define FFT_CONJ_IN   (1)
+#define FFT_CONJ_OUT  (2)
+
+/** conjugate the @p size points of @p in and scale them by @p scale */
+static void
+conjugate(cplx_float_t * restrict in, int size, float scale)
+{
+	int i;
+	for (i = 0; i < size; i++)
+	{
+		in[i].x = in[i].x * scale;
+		in[i].y = -in[i].y * scale;
+	}
+}
+
+#if FFT_WINDOW != FFT_WINDOW_NONE
+/** multiply the points [@p first, @p last) of the row @p c of the transposed
+ *  input by the window: point r is sample n = r*WIDTH + c, the cosines
+ *  being computed by recurrence from the first one (as twiddle_correction_)
+ */
+static void
+window(cplx_float_t * restrict in, int c, int first, int last)
+{
+	double a = 2*M_PI*((double)first*WIDTH + c)/((double)WIDTH*HEIGHT);
+	float cs = (float)cos(a), sn = (float)sin(a);
+	const float omega_c = (float)cos(2*M_PI/HEIGHT);
+	const float omega_s = (float)sin(2*M_PI/HEIGHT);
+	int r;
+	for (r = first; r < last; r++)
+	{
+		float w = FFT_WINDOW_A0 - FFT_WINDOW_A1*cs + FFT_WINDOW_A2*(2*cs*cs - 1);
+		in[r].x *= w;
+		in[r].y *= w;
+		float x_ = cs;
+		cs = x_ * omega_c - sn * omega_s;
+		sn = x_ * omega_s + sn * omega_c;
+	}
+}
+#endif
+
+#if FFT_OUTPUT != FFT_OUTPUT_COMPLEX
+/** output stage of the points [@p first, @p last) of a row: power,
+ *  magnitude or dB (FFT_OUTPUT) written as floats to @p out
+ */
+static void
+output_stage(const cplx_float_t * restrict in, float * restrict out, int first, int last)
+{
+	int i;
+	for (i = first; i < last; i++)
+	{
+		float p = in[i].x * in[i].x + in[i].y * in[i].y;
+		#if FFT_OUTPUT == FFT_OUTPUT_MAGNITUDE
+		out[i] = sqrtf(p);
+		#elif FFT_OUTPUT == FFT_OUTPUT_DB
+		out[i] = 10.0f*log10f(p + FFT_DB_FLOOR);
+		#else
+		out[i] = p;
+		#endif
+	}
+}
+#endif
+
+/** pointwise stages before the FFT of the points [@p first, @p last) of the
+ *  @p i th row of the PE: conjugation (inverse FFT) and window
+ */
+static void
+row_prologue(ffts_t *fft, cplx_float_t * restrict row, int i, int first, int last)
+{
+	if (fft->conj == FFT_CONJ_IN)
+	{
+		conjugate(&row[first], last-first, 1.0f);
+	}
+	#if FFT_WINDOW != FFT_WINDOW_NONE
+	if (fft->pass & FFT_PASS_WINDOW)
+	{
+		window(row, fft->row + i, first, last);
+	}
+	#endif
+}
+
+/** pointwise stages after the FFT of the points [@p first, @p last) of the
+ *  @p i th row of the PE: conjugation and scaling (inverse FFT), output stage
+ */
+static void
+row_epilogue(ffts_t *fft, cplx_float_t * restrict row, int i, int first, int last)
+{
+	if (fft->conj == FFT_CONJ_OUT)
+	{
+		conjugate(&row[first], last-first, 1.0f/((float)WIDTH*(float)HEIGHT));
+	}
+	#if FFT_OUTPUT != FFT_OUTPUT_COMPLEX
+	if (fft->out != NULL)
+	{
+		output_stage(row, &fft->out[i*fft->size], first, last);
+	}
+	#endif
+}
+
+/** intra-cluster barrier between the @p nb_pe PEs of a row group.
+ *  The counter is only increased, @p epoch counts the barriers already
+ *  crossed by the calling PE.
+ */
+static void
+pe_barrier(long long *sync, int nb_pe, int *epoch)
+{
+	__builtin_k1_wpurge();
+	__builtin_k1_fence();
+	(*epoch)++;
+	__builtin_k1_afdau(sync, 1);
+	while((long long)__builtin_k1_ldu(sync) < (long long)(*epoch)*nb_pe);
+	__builtin_k1_dinval();
+}
+
+/** cooperative radix-2 FFT of one row: the bit-reverse swaps and the
+ *  butterflies of each stage are split over the PEs of the row group.
+ *  The first stages work on independent sub-FFTs of size/nb_pe points
+ *  and need no synchronization, the log2(nb_pe) last ones are separated
+ *  by barriers.
+ */
+static void
+ffts_coop_row(cplx_float_t * restrict in, ffts_t *fft, int i, int *epoch)
+{
+	int nb_swap = fft_radix2_get_bitreverse_count(fft->array_bit_reverse)/2;
+	int chunk = fft->size/fft->nb_pe;
+	int m;
+	if (fft->conj == FFT_CONJ_IN || (fft->pass & FFT_PASS_WINDOW))
+	{
+		row_prologue(fft, in, i, fft->pe*chunk, (fft->pe+1)*chunk);
+		pe_barrier(fft->sync, fft->nb_pe, epoch);
+	}
+	if (fft->dif)
+	{
+		/* global stages first, then the independent sub-FFTs */
+		for (m = fft->size; m >= 2*chunk; m /= 2)
+		{
+			fft_radix2_float_dif_stages(in, fft->twiddle, fft->size, m, m,
+			                            fft->pe*(fft->size/2)/fft->nb_pe, (fft->pe+1)*(fft->size/2)/fft->nb_pe);
+			pe_barrier(fft->sync, fft->nb_pe, epoch);
+		}
+		fft_radix2_float_dif_stages(in, fft->twiddle, fft->size, chunk, 2,
+		                            fft->pe*chunk/2, (fft->pe+1)*chunk/2);
+	}else
+	{
+		fft_radix2_float_bitreverse(in, fft->array_bit_reverse,
+		                            2*(nb_swap*fft->pe/fft->nb_pe), 2*(nb_swap*(fft->pe+1)/fft->nb_pe));
+		pe_barrier(fft->sync, fft->nb_pe, epoch);
+		fft_radix2_float_stages(in, fft->twiddle, fft->size, 2, chunk,
+		                        fft->pe*chunk/2, (fft->pe+1)*chunk/2);
+		for (m = 2*chunk; m <= fft->size; m *= 2)
+		{
+			pe_barrier(fft->sync, fft->nb_pe, epoch);
+			fft_radix2_float_stages(in, fft->twiddle, fft->size, m, m,
+			                        fft->pe*(fft->size/2)/fft->nb_pe, (fft->pe+1)*(fft->size/2)/fft->nb_pe);
+		}
+	}
+	/* the row must be complete before any PE of the group moves on */
+	pe_barrier(fft->sync, fft->nb_pe, epoch);
+	row_epilogue(fft, in, i, fft->pe*chunk, (fft->pe+1)*chunk);
+}
+
+/** FFT of the @p i th row of the PE when only part of its input or of its
+ *  output is live (FFT_PASS_PRUNE_IN/OUT): the radix-2 kernels skip the dead
+ *  points, the other ones get the dead input points zeroed
+ */
+static void
+ffts_pruned_row(ffts_t *fft, cplx_float_t * restrict row, int i)
+{
+	if (fft->pass & FFT_PASS_PRUNE_IN)
+	{
+		/* row c of the transposed input: points r*WIDTH + c < FFT_INPUT_POINTS */
+		int c = fft->row + i;
+		int live = c >= FFT_INPUT_POINTS ? 0 : min(fft->size, (FFT_INPUT_POINTS - c + WIDTH - 1)/WIDTH);
+		if (fft->row_plan->kind == FFT_ROW_RADIX2)
+		{
+			fft_radix2_float_dif_pruned(row, fft->twiddle, fft->size, live);
+			if (!fft->dif)
+			{
+				fft_radix2_float_bitreverse(row, fft->array_bit_reverse, 0,
+				                            fft_radix2_get_bitreverse_count(fft->array_bit_reverse));
+			}
+			return;
+		}
+		memset(&row[live], 0, (fft->size - live)*sizeof(*row));
+	}else if (fft->row_plan->kind == FFT_ROW_RADIX2)
+	{
+		fft_radix2_float_pruned_out(row, fft->twiddle, fft->array_bit_reverse, fft->size,
+		                            PRUNE_OUT_FIRST, PRUNE_OUT_LAST);
+		return;
+	}
+	fft_row_execute(fft->row_plan, row, fft->work);
+}
+
+/** signal the last row sent by the PE once its DMAs are done */
+static void
+ffts_send_flush(ffts_t *fft)
+{
+	if (fft->pending > 0)
+	{
+		mppa_async_event_wait(&fft->evt);
+		row_send_signal(fft->send, fft->pe, fft->nb_pe);
+	}
+	fft->pending = 0;
+}
+
+/** send the @p i th row of the PE, @p row or its output stage, after
+ *  signalling the previous one: the DMAs of a row overlap the FFT of the
+ *  next one
+ */
+static void
+ffts_send(ffts_t *fft, cplx_float_t * restrict row, int i)
+{
+	const void *local = fft->out != NULL ? (void*)&fft->out[i*fft->size] : (void*)row;
+	ffts_send_flush(fft);
+	int nb_dma = row_send(fft->send, local, fft->row + i, fft->pe, fft->nb_pe, &fft->evt);
+	if (nb_dma < 0)
+	{
+		fft->err = -1;
+		return;
+	}
+	fft->pending = nb_dma;
+	fft->nb_dma += nb_dma;
+}
+
 static void*
 ffts_(void *args)
 {
 	int i;
 	ffts_t *fft = (void*)args;
 	__builtin_k1_dinval();
-	for (i = 0; i < fft->height; i++)
+	if (fft->nb_pe == 1)
+	{
+		for (i = 0; i < fft->height; i++)
+		{
+			cplx_float_t *row = &(fft->in[i*fft->size]);
+			row_prologue(fft, row, i, 0, fft->size);
+			if (fft->pass & (FFT_PASS_PRUNE_IN | FFT_PASS_PRUNE_OUT))
+			{
+				ffts_pruned_row(fft, row, i);
+			}else if (fft->dif)
+			{
+				fft_radix2_float_dif(row, fft->twiddle, fft->size);
+			}else
+			{
+				fft_row_execute(fft->row_plan, row, fft->work);
+			}
+			row_epilogue(fft, row, i, 0, fft->size);
+			if (fft->send != NULL)
+			{
+				ffts_send(fft, row, i);
+			}
+		}
+	}else
 	{
-		fft_radix2_float(&(fft->in[i*TILE_WIDTH]), fft->twiddle, fft->array_bit_reverse, fft->size);
+		int epoch = 0;
+		for (i = 0; i < fft->height; i++)
+		{
+			ffts_coop_row(&(fft->in[i*fft->size]), fft, i, &epoch);
+			if (fft->send != NULL)
+			{
+				/* the PEs of the row share its targets */
+				pe_barrier(fft->sync, fft->nb_pe, &epoch);
+				ffts_send(fft, &(fft->in[i*fft->size]), i);
+			}
+		}
+		if (fft->send != NULL)
+		{
+			/* the local blocks of every PE are copied before the last signal */
+			pe_barrier(fft->sync, fft->nb_pe, &epoch);
+		}
+	}
+	if (fft->send != NULL)
+	{
+		ffts_send_flush(fft);
 	}
 	__builtin_k1_wpurge();
 	__builtin_k1_fence();
@@ -175,20 +871,132 @@ ffts_(void *args)
 #define NB_FFT_CORE (N_CORES)
 static pthread_t t[NB_FFT_CORE];
 static ffts_t fft[NB_FFT_CORE];
+static long long row_sync[NB_FFT_CORE] __attribute__((aligned(8)));
+static cplx_float_t *row_work[NB_FFT_CORE];
 
-void
-ffts(cplx_float_t * restrict in, const float *twiddle, const int *array_bit_reverse, const int size)
+/** (re)build the column and row plans for plan.radix and the row FFT
+ *  scratch of every PE
+ */
+static void
+fft_plans_create(void)
 {
+	int kind = plan.radix == FFT_RADIX_MIXED ? FFT_ROW_MIXED : FFT_ROW_RADIX2;
 	int i;
+	if (row_plan != NULL && row_plan != col_plan)
+	{
+		fft_row_plan_destroy(row_plan);
+	}
+	if (col_plan != NULL)
+	{
+		fft_row_plan_destroy(col_plan);
+	}
+	col_plan = fft_row_plan_create(HEIGHT, kind);
+	row_plan = HEIGHT == WIDTH ? col_plan : fft_row_plan_create(WIDTH, kind);
+	int work_size = col_plan->work_size > row_plan->work_size ? col_plan->work_size : row_plan->work_size;
 	for (i = 0; i < NB_FFT_CORE; i++)
 	{
-		int nb_fft = TILE_HEIGHT/NB_FFT_CORE + (((TILE_HEIGHT%NB_FFT_CORE) > i) ? 1 : 0);
-		fft[i].in = (void*)&in[TILE_WIDTH*(i*(TILE_HEIGHT/NB_FFT_CORE) + min(i,TILE_HEIGHT%NB_FFT_CORE))];
-		fft[i].twiddle = (float*)twiddle;
-		fft[i].array_bit_reverse = (int*)array_bit_reverse;
+		free(row_work[i]);
+		row_work[i] = NULL;
+		posix_memalign((void**)&row_work[i], 64, sizeof(cplx_float_t)*(work_size > 0 ? work_size : 1));
+		if (row_work[i] == NULL)
+		{
+			printf("Cluster %d failed to alloc row FFT scratch of %d points\n", group_rank, work_size);
+			mOS_exit(1,-1);
+		}
+	}
+}
+/* PEs used by ffts() and twiddle_correction(), lowered by the microbenchmarks */
+static int nb_fft_core = NB_FFT_CORE;
+
+/** number of PEs computing a single row: the plan value if set,
+ *  otherwise the largest power of two such that the PEs that would stay idle
+ *  with one row per PE share the rows. Only radix-2 rows are shared.
+ */
+static int
+ffts_pe_per_row(int height, const fft_row_plan_t *row_plan)
+{
+	int nb_pe = 1;
+	int size = row_plan->size;
+	if (row_plan->kind != FFT_ROW_RADIX2)
+	{
+		return 1;
+	}
+	if (plan.pe_per_row > 0)
+	{
+		nb_pe = plan.pe_per_row;
+		/* the stage split follows radix-2 boundaries: round down to a power of two */
+		while (nb_pe & (nb_pe-1))
+		{
+			nb_pe &= nb_pe-1;
+		}
+	}else
+	{
+		while (nb_pe*2*height <= nb_fft_core)
+		{
+			nb_pe *= 2;
+		}
+	}
+	while (nb_pe > 1 && (nb_pe > nb_fft_core || size/nb_pe < 2))
+	{
+		nb_pe /= 2;
+	}
+	return nb_pe;
+}
+
+/** FFTs of the @p height rows of a tile, @p dif selects the bit-reversed
+ *  output kernel (radix-2 rows only), @p conj the FFT_CONJ_* step of an
+ *  inverse FFT done with the row FFTs
+ *  @param row global index of the first row of the tile
+ *  @param pass FFT_PASS_* stages of this pass; the pruned passes compute
+ *              one row per PE
+ *  @param out if not NULL, the output stage (FFT_OUTPUT) of row i is written
+ *             to out[i*row_plan->size]
+ *  @param send if not NULL, each row (or its output stage) is sent to the
+ *              transposed matrix as soon as it is computed, the caller waits
+ *              for the rows of the other clusters with row_send_receive()
+ * @return 0 on success, non-zero error code otherwise
+ */
+int
+ffts(cplx_float_t * restrict in, const fft_row_plan_t *row_plan, const int height, const int dif, const int conj,
+     const int row, const int pass, float *out, const row_send_t *send)
+{
+	int err = 0;
+	int i;
+	int size = row_plan->size;
+	int nb_pe = (pass & (FFT_PASS_PRUNE_IN | FFT_PASS_PRUNE_OUT)) ? 1 : ffts_pe_per_row(height, row_plan);
+	int nb_group = nb_fft_core/nb_pe;
+	int nb_core = nb_group*nb_pe;
+	for (i = 0; i < nb_group; i++)
+	{
+		row_sync[i] = 0;
+	}
+	__builtin_k1_wpurge();
+	__builtin_k1_fence();
+	for (i = 0; i < nb_core; i++)
+	{
+		int g = i/nb_pe;
+		int nb_fft = height/nb_group + (((height%nb_group) > g) ? 1 : 0);
+		int first = g*(height/nb_group) + min(g,height%nb_group);
+		fft[i].in = (void*)&in[size*first];
+		fft[i].row = row + first;
+		fft[i].pass = pass;
+		fft[i].out = out != NULL ? &out[size*first] : NULL;
+		fft[i].row_plan = row_plan;
+		fft[i].work = row_work[i];
+		fft[i].twiddle = row_plan->twiddle;
+		fft[i].array_bit_reverse = row_plan->lut;
 		fft[i].size = size;
 		fft[i].height = nb_fft;
-		if(i<NB_FFT_CORE-1)
+		fft[i].dif = dif;
+		fft[i].conj = conj;
+		fft[i].pe = i%nb_pe;
+		fft[i].nb_pe = nb_pe;
+		fft[i].sync = &row_sync[g];
+		fft[i].send = send;
+		fft[i].pending = 0;
+		fft[i].nb_dma = 0;
+		fft[i].err = 0;
+		if(i<nb_core-1)
 		{
 	 		pthread_create(&t[i], NULL, (void*)ffts_, (void*)&fft[i]); // PE1 -> PE(N-1)
 		}else
@@ -196,16 +1004,24 @@ ffts(cplx_float_t * restrict in, const float *twiddle, const int *array_bit_reve
 			ffts_((void*)&fft[i]); // PE0 work
 		}
 	}
-	for (i = 0; i < NB_FFT_CORE-1; i++)
+	for (i = 0; i < nb_core-1; i++)
 	{
 		pthread_join(t[i], NULL); // join PE1 -> PE(N-1)
 	}
+	for (i = 0; i < nb_core; i++)
+	{
+		nb_job_dma += fft[i].nb_dma;
+		err |= fft[i].err;
+	}
+	return err;
 }
 
 typedef struct{
 	cplx_float_t * restrict in;
+	const float *coef;
 	int start_twid;
 	int height;
+	int width;
 }twiddle_correction_t;
 
 static twiddle_correction_t twid[NB_FFT_CORE];
@@ -216,21 +1032,22 @@ twiddle_correction_(void *args)
 	twiddle_correction_t *twid = (void*)args;
 	__builtin_k1_dinval();
 	int i, j, k = twid->start_twid*2;
+	int width = twid->width;
 	cplx_float_t *restrict in = twid->in;
 	for(i=0;i<twid->height;i++)
 	{
 		float c = 1;
 		float s = 0;
-		float omega_c = correction_twiddle_coef[k+0];
-		float omega_s = correction_twiddle_coef[k+1];
+		float omega_c = twid->coef[k+0];
+		float omega_s = twid->coef[k+1];
 		k += 2;
-		for(j=0;j<TILE_WIDTH;j++)
+		for(j=0;j<width;j++)
 		{
 
-			float x = in[i*TILE_WIDTH + j].x;
-			float y = in[i*TILE_WIDTH + j].y;
-			in[i*TILE_WIDTH + j].x = x * c - y * s;
-			in[i*TILE_WIDTH + j].y = y * c + x * s;
+			float x = in[i*width + j].x;
+			float y = in[i*width + j].y;
+			in[i*width + j].x = x * c - y * s;
+			in[i*width + j].y = y * c + x * s;
 
 			float x_ = c;
 			c = x_ * omega_c - s * omega_s;
@@ -244,18 +1061,23 @@ twiddle_correction_(void *args)
 }
 
 
+/** twiddle correction of the @p height rows of @p width points of a tile,
+ *  @p coef holding the per-row factors of fft_get_correction_twiddle()
+ */
 void
-twiddle_correction(cplx_float_t * restrict in)
+twiddle_correction(cplx_float_t * restrict in, const float *coef, int height, int width)
 {
 	int i;
-	for (i = 0; i < NB_FFT_CORE; i++)
+	for (i = 0; i < nb_fft_core; i++)
 	{
-		int nb_twid = TILE_HEIGHT/NB_FFT_CORE + (((TILE_HEIGHT%NB_FFT_CORE) > i) ? 1 : 0);
-		int start_twid = (i*(TILE_HEIGHT/NB_FFT_CORE) + min(i,TILE_HEIGHT%NB_FFT_CORE));
-		twid[i].in = (void*)&in[start_twid*TILE_WIDTH];
+		int nb_twid = height/nb_fft_core + (((height%nb_fft_core) > i) ? 1 : 0);
+		int start_twid = (i*(height/nb_fft_core) + min(i,height%nb_fft_core));
+		twid[i].in = (void*)&in[start_twid*width];
+		twid[i].coef = coef;
 		twid[i].start_twid = start_twid;
 		twid[i].height = nb_twid;
-		if(i < NB_FFT_CORE-1)
+		twid[i].width = width;
+		if(i < nb_fft_core-1)
 		{
 			pthread_create(&t[i], NULL, (void*)twiddle_correction_, (void*)&twid[i]);  // PE1 -> PE(N-1)
 		}else
@@ -263,105 +1085,914 @@ twiddle_correction(cplx_float_t * restrict in)
 			twiddle_correction_((void*)&twid[i]); // PE0 work
 		}
 	}
+	for (i = 0; i < nb_fft_core-1; i++)
+	{
+		pthread_join(t[i], NULL); // join PE1 -> PE(N-1)
+	}
+}
+
+static mppa_async_segment_t matrix_segment;
+static mppa_async_segment_t matrix_segment_out;
+/* byte offsets of the matrix in the input and output segments, moved by
+ * FFT_CMD_EXECUTE in a resident service */
+static off64_t input_offset = 0;
+static off64_t output_offset = 0;
+static mppa_async_segment_t plan_segment;
+#if FFT_MODE == FFT_MODE_CONV
+static mppa_async_segment_t filter_segment;
+#endif
+#ifdef DEBUG_DUMP
+static uint64_t s0,s1,s2,s3,s4;
+#endif
+
+/** 6-step FFT of the tiles submatrix_a[@p buffer] (input rows), the
+ *  result is left in TILE_B(@p buffer) (output rows, natural order).
+ *  With FFT_PIPELINE the column and row FFTs send their rows themselves,
+ *  the second and last transposes only wait for the other bands.
+ *  @param inverse non-zero for the inverse FFT, scaled by 1/(WIDTH*HEIGHT)
+ *  @param conj_in FFT_CONJ_IN if the input still has to be conjugated
+ *                 (inverse only), FFT_CONJ_NONE if the caller already did
+ *  The window (FFT_WINDOW) is fused in the column FFTs and the output stage
+ *  (FFT_OUTPUT) in the row FFTs, the latter leaving floats in TILE_B.
+ *  @return 0 on success, non-zero error code otherwise
+ */
+static int
+fft_6step(int buffer, int inverse, int conj_in)
+{
+	/* the DIF kernel only exists for radix-2 rows, the pipelined transposes
+	 * send contiguous row blocks */
+	int col_dif = (plan.kernel == FFT_KERNEL_RADIX2_DIF && col_plan->kind == FFT_ROW_RADIX2 && !FFT_PIPELINE);
+	/* the output-pruned rows and the transposed order output are in natural order */
+	int row_dif = (plan.kernel == FFT_KERNEL_RADIX2_DIF && row_plan->kind == FFT_ROW_RADIX2 && !FFT_PRUNE_OUTPUT &&
+	               FFT_ORDER == FFT_ORDER_NATURAL && !FFT_PIPELINE);
+	const row_send_t *send = NULL;
+
+	/* the zero rows of a padded input are not sent */
+	int err = FFT_PRUNE_INPUT ?
+		flat_transpose(submatrix_a[buffer], TILE_B(buffer), HEIGHT, WIDTH, NULL, plan.dma, sizeof(cplx_float_t), PRUNE_IN_ROWS, 0, WIDTH) :
+		transpose(submatrix_a[buffer], TILE_B(buffer), HEIGHT, WIDTH, NULL);
+	if (err) return err;
+	#ifdef DEBUG_DUMP
+	dump_submatrix((void*)TILE_B(buffer), TILE_T_WIDTH, tile_t_height);
+	s0 = __k1_read_dsu_timestamp();
+	#endif
+
+	/* the window and the pruning apply to the input data, not to the inverse
+	 * pass of the unfused convolution */
+	int pass = (!inverse || conj_in == FFT_CONJ_IN) ? FFT_PASS_INPUT : 0;
+	#if FFT_PIPELINE
+	/* the column FFTs send their rows to submatrix_a as they go */
+	row_send_t col_send = row_send_init(submatrix_a[buffer], WIDTH, HEIGHT, sizeof(cplx_float_t), 0, HEIGHT);
+	send = &col_send;
+	#endif
+	err = ffts((void*)TILE_B(buffer), col_plan, tile_t_height, col_dif, inverse ? conj_in : FFT_CONJ_NONE, tile_t_row, pass, NULL, send);
+	if (err) return err;
+	#ifdef DEBUG_DUMP
+	dump_submatrix((void*)TILE_B(buffer), TILE_T_WIDTH, tile_t_height);
+	s1 = __k1_read_dsu_timestamp();
+	#endif
+
+	if (send != NULL)
+	{
+		row_send_receive(send);
+	}else
+	{
+		err = transpose(TILE_B(buffer), submatrix_a[buffer], WIDTH, HEIGHT, col_dif ? col_plan->rev : NULL);
+		if (err) return err;
+	}
+	#ifdef DEBUG_DUMP
+	dump_submatrix((void*)submatrix_a[buffer], TILE_WIDTH, tile_height);
+	s2 = __k1_read_dsu_timestamp();
+	#endif
+
+	twiddle_correction((void*)submatrix_a[buffer], correction_twiddle_coef, tile_height, TILE_WIDTH);
+	#ifdef DEBUG_DUMP
+	dump_submatrix((void*)submatrix_a[buffer], TILE_WIDTH, tile_height);
+	s3 = __k1_read_dsu_timestamp();
+	#endif
+
+	#if FFT_PIPELINE && FFT_ORDER == FFT_ORDER_NATURAL
+	/* the row FFTs send their rows, or their output stage, to TILE_B */
+	row_send_t row_send = row_send_init(TILE_B(buffer), HEIGHT, WIDTH, FFT_OUTPUT_SIZE, PRUNE_OUT_FIRST, PRUNE_OUT_LAST);
+	send = &row_send;
+	#else
+	send = NULL;
+	#endif
+	err = ffts((void*)submatrix_a[buffer], row_plan, tile_height, row_dif, inverse ? FFT_CONJ_OUT : FFT_CONJ_NONE, tile_row, FFT_PASS_OUTPUT, OUTPUT_TILE, send);
+	if (err) return err;
+	#ifdef DEBUG_DUMP
+	dump_submatrix((void*)submatrix_a[buffer], TILE_WIDTH, tile_height);
+	s4 = __k1_read_dsu_timestamp();
+	#endif
+
+	if (send != NULL)
+	{
+		row_send_receive(send);
+		return 0;
+	}
+	#if FFT_ORDER == FFT_ORDER_TRANSPOSED
+	/* the rows of the tile are the output in transposed order */
+	return 0;
+	#elif FFT_OUTPUT != FFT_OUTPUT_COMPLEX
+	/* the output stage left floats in output_tile, the last transpose moves
+	 * half the bytes (out-of-place only) */
+	return flat_transpose(output_tile, TILE_B(buffer), HEIGHT, WIDTH, row_dif ? row_plan->rev : NULL, plan.dma, sizeof(float),
+	                      HEIGHT, PRUNE_OUT_FIRST, PRUNE_OUT_LAST);
+	#else
+	/* only the rows of the output band are sent */
+	return FFT_PRUNE_OUTPUT ?
+		flat_transpose(submatrix_a[buffer], TILE_B(buffer), HEIGHT, WIDTH, NULL, plan.dma, sizeof(cplx_float_t), HEIGHT, PRUNE_OUT_FIRST, PRUNE_OUT_LAST) :
+		transpose(submatrix_a[buffer], TILE_B(buffer), HEIGHT, WIDTH, row_dif ? row_plan->rev : NULL);
+	#endif
+}
+
+#if FFT_MODE == FFT_MODE_CONV
+/** load the filter spectrum from the filter segment in @p layout
+ *  (FILTER_TRANSPOSED or FILTER_NATURAL), unless it is already resident
+ */
+static void
+filter_load(int layout)
+{
+	int i;
+	if (filter_layout == layout)
+	{
+		return;
+	}
+	if (layout == FILTER_NATURAL)
+	{
+		mppa_async_get(filter, &filter_segment, tile_row*TILE_WIDTH*sizeof(filter[0][0]),
+		               TILE_WIDTH*tile_height*sizeof(filter[0][0]), NULL);
+	}else
+	{
+		/* row i gathers H[k1 + HEIGHT*k2] for every k2 */
+		for (i = 0; i < tile_height; i++)
+		{
+			mppa_async_get_spaced(&filter[0][0] + i*TILE_WIDTH, &filter_segment, (tile_row + i)*sizeof(filter[0][0]),
+			                      sizeof(filter[0][0]), TILE_WIDTH, HEIGHT*sizeof(filter[0][0]), NULL);
+		}
+	}
+	filter_layout = layout;
+}
+
+typedef struct{
+	cplx_float_t * restrict in;
+	const cplx_float_t * restrict filter;
+	int size;
+}filter_multiply_t;
+
+static filter_multiply_t filter_job[NB_FFT_CORE];
+
+static void*
+filter_multiply_(void *args)
+{
+	filter_multiply_t *job = (void*)args;
+	__builtin_k1_dinval();
+	int i;
+	for (i = 0; i < job->size; i++)
+	{
+		float x = job->in[i].x;
+		float y = job->in[i].y;
+		float fx = job->filter[i].x;
+		#ifdef FFT_CORRELATE
+		float fy = -job->filter[i].y;
+		#else
+		float fy = job->filter[i].y;
+		#endif
+		/* conj(in*filter): the input of the inverse FFT */
+		job->in[i].x = x * fx - y * fy;
+		job->in[i].y = -(x * fy + y * fx);
+	}
+	__builtin_k1_wpurge();
+	__builtin_k1_fence();
+	return NULL;
+}
+
+/** multiply the tile @p in by the resident filter spectrum (by its
+ *  conjugate for FFT_CORRELATE builds) and conjugate the product
+ */
+static void
+filter_multiply(cplx_float_t * restrict in)
+{
+	int i;
+	const int size = tile_height*TILE_WIDTH;
+	for (i = 0; i < NB_FFT_CORE; i++)
+	{
+		int start = i*(size/NB_FFT_CORE) + min(i, size%NB_FFT_CORE);
+		filter_job[i].in = &in[start];
+		filter_job[i].filter = &filter[0][0] + start;
+		filter_job[i].size = size/NB_FFT_CORE + (((size%NB_FFT_CORE) > i) ? 1 : 0);
+		if(i < NB_FFT_CORE-1)
+		{
+			pthread_create(&t[i], NULL, (void*)filter_multiply_, (void*)&filter_job[i]);  // PE1 -> PE(N-1)
+		}else
+		{
+			filter_multiply_((void*)&filter_job[i]); // PE0 work
+		}
+	}
 	for (i = 0; i < NB_FFT_CORE-1; i++)
 	{
 		pthread_join(t[i], NULL); // join PE1 -> PE(N-1)
 	}
 }
 
-/* main on PE 0 */
-int main(void/*unused*/)
+/** fused circular convolution of the tiles submatrix_a[@p buffer] with the
+ *  filter: the spectrum stays in SMEM between the forward and the inverse
+ *  FFT. The forward FFT stops before its last transpose: its tiles then hold
+ *  the spectrum as the rows of the (WIDTH x HEIGHT)^T matrix, i.e. the input
+ *  of the inverse 6-step (WIDTH and HEIGHT swapped) after its first transpose.
+ *  Four transposes instead of six and no DDR round trip. The result is left
+ *  in submatrix_a[@p buffer] (input rows).
+ *  @return 0 on success, non-zero error code otherwise
+ */
+static int
+fft_conv_fused(int buffer)
 {
-	mppa_rpc_client_init();
-	mppa_async_init();
-	mppa_remote_client_init();
+	int col_dif = (plan.kernel == FFT_KERNEL_RADIX2_DIF && col_plan->kind == FFT_ROW_RADIX2);
+	int row_dif = (plan.kernel == FFT_KERNEL_RADIX2_DIF && row_plan->kind == FFT_ROW_RADIX2);
+
+	/* forward: the last row FFTs must leave the spectrum in natural order */
+	int err = transpose(submatrix_a[buffer], TILE_B(buffer), HEIGHT, WIDTH, NULL);
+	if (err) return err;
+	err = ffts((void*)TILE_B(buffer), col_plan, tile_t_height, col_dif, FFT_CONJ_NONE, tile_t_row, FFT_PASS_INPUT, NULL, NULL);
+	if (err) return err;
+	err = transpose(TILE_B(buffer), submatrix_a[buffer], WIDTH, HEIGHT, col_dif ? col_plan->rev : NULL);
+	if (err) return err;
+	twiddle_correction((void*)submatrix_a[buffer], correction_twiddle_coef, tile_height, TILE_WIDTH);
+	err = ffts((void*)submatrix_a[buffer], row_plan, tile_height, 0, FFT_CONJ_NONE, tile_row, 0, NULL, NULL);
+	if (err) return err;
 
-	int cid = __k1_get_cluster_id();
+	filter_multiply((void*)submatrix_a[buffer]);
+
+	/* inverse, the input conjugation being done by filter_multiply() */
+	err = ffts((void*)submatrix_a[buffer], row_plan, tile_height, row_dif, FFT_CONJ_NONE, tile_row, 0, NULL, NULL);
+	if (err) return err;
+	err = transpose(submatrix_a[buffer], TILE_B(buffer), HEIGHT, WIDTH, row_dif ? row_plan->rev : NULL);
+	if (err) return err;
+	twiddle_correction((void*)TILE_B(buffer), correction_twiddle_coef_t, tile_t_height, TILE_T_WIDTH);
+	err = ffts((void*)TILE_B(buffer), col_plan, tile_t_height, col_dif, FFT_CONJ_OUT, tile_t_row, 0, NULL, NULL);
+	if (err) return err;
+	return transpose(TILE_B(buffer), submatrix_a[buffer], WIDTH, HEIGHT, col_dif ? col_plan->rev : NULL);
+}
+#endif
+
+/** put the tiles @p tile (rows @p row to @p row+@p height-1 of @p width
+ *  elements of @p esize bytes) to the output segment and wait for completion
+ *  @param comm incremented by the cycles spent in DDR accesses
+ */
+static void
+put_tile(void *tile, int row, int height, int width, size_t esize, uint64_t *comm)
+{
+	mppa_async_event_t fence;
+	uint64_t tmp_dsu = __k1_read_dsu_timestamp();
+	mppa_async_put_spaced(tile, &matrix_segment_out, output_offset + row*width*esize,
+				width*esize, height, width*esize, &fence);
+	mppa_async_fence(&matrix_segment, &fence);
+	mppa_async_event_wait(&fence);
+	*comm += __k1_read_dsu_timestamp() - tmp_dsu;
+}
+
+/** run @p nb_iter distributed FFTs (FFT_MODE) with the current plan
+ *  @param comm incremented by the cycles spent in DDR accesses
+ *  @return 0 on success, non-zero error code otherwise
+ */
+static int
+fft_iterations(int nb_iter, uint64_t *comm)
+{
 	int buffer = 0;
-	lut = fft_radix2_get_bitreverse(TILE_WIDTH);
-	twiddle = fft_radix2_get_twiddle_float(TILE_WIDTH);
-	correction_twiddle_coef = fft_get_correction_twiddle(WIDTH, HEIGHT);
+	int i;
+	for(i=0;i<nb_iter;i++)
+	{
+		uint64_t tmp_dsu = __k1_read_dsu_timestamp();
+		/* zero padded input: only the live rows are fetched */
+		if (tile_live_height > 0)
+		{
+			mppa_async_get_spaced(submatrix_a[buffer], &matrix_segment, input_offset + tile_row*TILE_WIDTH*sizeof(submatrix_a[0][0][0]),
+						TILE_WIDTH*sizeof(submatrix_a[0][0][0]), tile_live_height, TILE_WIDTH*sizeof(submatrix_a[0][0][0]), NULL);
+		}
+		*comm += __k1_read_dsu_timestamp() - tmp_dsu;
 
-	mppa_async_segment_t matrix_segment;
-	mppa_async_segment_t matrix_segment_out;
-	mppa_async_segment_clone(&matrix_segment, MATRIX_SEGMENT_ID, 0, 0, NULL); // input fft samples
-	mppa_async_segment_clone(&matrix_segment_out, MATRIX_SEGMENT_ID+1, 0, 0, NULL); // input fft samples
+		#if FFT_MODE == FFT_MODE_CONV
+		if (conv_fused)
+		{
+			filter_load(FILTER_TRANSPOSED);
+			int err = fft_conv_fused(buffer);
+			if (err) return err;
+			put_tile(submatrix_a[buffer], tile_row, tile_height, TILE_WIDTH, sizeof(cplx_float_t), comm);
+		}else
+		{
+			/* forward FFT to DDR, then product and inverse FFT from DDR */
+			int err = fft_6step(buffer, 0, FFT_CONJ_NONE);
+			if (err) return err;
+			put_tile(TILE_B(buffer), tile_t_row, tile_t_height, TILE_T_WIDTH, sizeof(cplx_float_t), comm);
+			group_barrier();
+			tmp_dsu = __k1_read_dsu_timestamp();
+			mppa_async_get_spaced(submatrix_a[buffer], &matrix_segment_out, output_offset + tile_row*TILE_WIDTH*sizeof(submatrix_a[0][0][0]),
+						TILE_WIDTH*sizeof(submatrix_a[0][0][0]), tile_height, TILE_WIDTH*sizeof(submatrix_a[0][0][0]), NULL);
+			*comm += __k1_read_dsu_timestamp() - tmp_dsu;
+			filter_load(FILTER_NATURAL);
+			filter_multiply((void*)submatrix_a[buffer]);
+			err = fft_6step(buffer, 1, FFT_CONJ_NONE);
+			if (err) return err;
+			put_tile(TILE_B(buffer), tile_t_row, tile_t_height, TILE_T_WIDTH, sizeof(cplx_float_t), comm);
+		}
+		#else
+		int err = fft_6step(buffer, FFT_MODE == FFT_MODE_INVERSE, FFT_CONJ_IN);
+		if (err) return err;
+		#if FFT_ORDER == FFT_ORDER_TRANSPOSED
+		/* no last transpose: row k1 of the band holds the bins k1 + HEIGHT*k2 */
+		put_tile(FFT_OUTPUT == FFT_OUTPUT_COMPLEX ? (void*)submatrix_a[buffer] : (void*)OUTPUT_TILE,
+		         tile_row, tile_height, TILE_WIDTH, FFT_OUTPUT_SIZE, comm);
+		#else
+		/* FFT_OUTPUT_POWER/MAGNITUDE/DB: floats, half the bytes; output band:
+		 * only its rows */
+		if (tile_t_live_height > 0)
+		{
+			put_tile((void*)TILE_B(buffer) + (tile_t_live_row - tile_t_row)*TILE_T_WIDTH*FFT_OUTPUT_SIZE,
+			         tile_t_live_row, tile_t_live_height, TILE_T_WIDTH, FFT_OUTPUT_SIZE, comm);
+		}
+		#endif
+		#endif
 
-	mppa_async_offset(mppa_async_default_segment(0), (void*)&go, &go_offset);
+		group_barrier();
+	}
+	return 0;
+}
 
-	#ifdef DEBUG_DUMP
-	mppa_rpc_barrier_all();
+/** set up this cluster for the WIDTH x HEIGHT matrix: its bands, twiddle
+ *  corrections and row plans, with the plan stored by the IO in the plan
+ *  segment (wisdom file) or else the build defaults
+ *  @return non-zero if the IO provided the plan
+ */
+static int
+fft_setup(void)
+{
+	int cid = group_rank;
+	tile_row = BAND_START(HEIGHT, cid);
+	tile_height = BAND_SIZE(HEIGHT, cid);
+	tile_t_row = BAND_START(WIDTH, cid);
+	tile_t_height = BAND_SIZE(WIDTH, cid);
+	tile_live_height = max(0, min(tile_height, PRUNE_IN_ROWS - tile_row));
+	tile_t_live_row = max(tile_t_row, PRUNE_OUT_FIRST);
+	tile_t_live_height = max(0, min(tile_t_row + tile_t_height, PRUNE_OUT_LAST) - tile_t_live_row);
+	free(correction_twiddle_coef);
+	correction_twiddle_coef = fft_get_correction_twiddle(WIDTH, HEIGHT, cid);
+	#if FFT_MODE == FFT_MODE_CONV
+	free(correction_twiddle_coef_t);
+	correction_twiddle_coef_t = fft_get_correction_twiddle(HEIGHT, WIDTH, cid);
+	filter_layout = -1;
+	#endif
+
+	/* the plan stored by the IO (wisdom file) overrides the build defaults */
+	fft_plan_t wisdom;
+	mppa_async_get(&wisdom, &plan_segment, 0, sizeof(wisdom), NULL);
+	plan = wisdom.valid ? wisdom : plan_default;
+	#ifdef FFT_INPLACE_TRANSPOSE
+	/* the in-place transpose only moves natural order blocks */
+	plan.kernel = FFT_KERNEL_RADIX2_DIT;
+	#endif
+	/* the bit-reversed gather of the DIF kernel (col_lut) needs one DMA per
+	 * column, whatever the wisdom file asked for */
+	if (plan.kernel == FFT_KERNEL_RADIX2_DIF)
+	{
+		plan.dma = FFT_DMA_COLUMN;
+	}
+	fft_plans_create();
+	return wisdom.valid;
+}
+
+#ifdef FFT_AUTOTUNE
+/** time every candidate plan and publish the fastest one in the plan
+ *  segment. All the clusters of the group run the same sequence of
+ *  candidates; since every iteration ends with a group barrier, its first
+ *  cluster times it alone and picks the winner.
+ *  @return 0 on success, non-zero error code otherwise
+ */
+static int
+fft_autotune(void)
+{
+	int cid = group_rank;
+	fft_plan_t best = plan;
+	best.time_ms = -1.0f;
+	int radix, kernel, nb_pe, dma;
+	/* the radix only changes the kernel of the power of two sides */
+	int pow2 = ((WIDTH & (WIDTH-1)) == 0 || (HEIGHT & (HEIGHT-1)) == 0);
+	for (radix = FFT_RADIX_2; radix <= (pow2 ? FFT_RADIX_MIXED : FFT_RADIX_2); radix++)
+	{
+		plan.radix = radix;
+		fft_plans_create();
+		int radix2 = (col_plan->kind == FFT_ROW_RADIX2 || row_plan->kind == FFT_ROW_RADIX2);
+		for (kernel = FFT_KERNEL_RADIX2_DIT; kernel <= FFT_KERNEL_RADIX2_DIF; kernel++)
+		{
+			for (nb_pe = 1; nb_pe <= NB_FFT_CORE; nb_pe *= 2)
+			{
+				for (dma = FFT_DMA_COLUMN; dma <= FFT_DMA_ROW; dma++)
+				{
+					/* the bit-reversed gather needs one DMA per column */
+					if (kernel == FFT_KERNEL_RADIX2_DIF && dma != FFT_DMA_COLUMN)
+					{
+						continue;
+					}
+					/* the DIF kernel and the shared rows are radix-2 only */
+					if (!radix2 && (kernel != FFT_KERNEL_RADIX2_DIT || nb_pe > 1))
+					{
+						continue;
+					}
+					#ifdef FFT_INPLACE_TRANSPOSE
+					/* the in-place transpose only moves natural order blocks */
+					if (kernel != FFT_KERNEL_RADIX2_DIT || dma != FFT_DMA_COLUMN)
+					{
+						continue;
+					}
+					#endif
+					uint64_t comm = 0;
+					plan.kernel = kernel;
+					plan.pe_per_row = nb_pe;
+					plan.dma = dma;
+					/* warm-up */
+					int err = fft_iterations(1, &comm);
+					if (err) return err;
+					uint64_t start = __k1_read_dsu_timestamp();
+					err = fft_iterations(NB_AUTOTUNE_ITER, &comm);
+					if (err) return err;
+					float time_ms = (float)(__k1_read_dsu_timestamp() - start)/((float)__bsp_frequency/1000.0f)/NB_AUTOTUNE_ITER;
+					if (best.time_ms < 0 || time_ms < best.time_ms)
+					{
+						best = plan;
+						best.time_ms = time_ms;
+					}
+					#ifdef DEBUG_DUMP
+					if(cid == 0)
+					{
+						printf("# autotune radix %d kernel %d pe_per_row %d dma %d time_ms %.4f\n", radix, kernel, nb_pe, dma, time_ms);
+					}
+					#endif
+				}
+			}
+		}
+	}
 	if(cid == 0)
 	{
-		printf("# MPPA - NB_CLUSTER %d in-chip flat FFT %d points. Matrix dim: %d %d. Matrix size: %d\n", NB_CLUSTER, WIDTH*HEIGHT, WIDTH, HEIGHT, WIDTH*HEIGHT*sizeof(submatrix_a[0][0][0]));
+		best.valid = 1;
+		best.searched = 1;
+		mppa_async_put(&best, &plan_segment, 0, sizeof(best), NULL);
+		mppa_async_fence(&plan_segment, NULL);
 	}
-	mppa_rpc_barrier_all();
+	group_barrier();
+	mppa_async_get(&plan, &plan_segment, 0, sizeof(plan), NULL);
+	fft_plans_create();
+	return 0;
+}
+#endif
 
-	printf("# Cluster %d NB_CLUSTER %d N %d TILE_WIDTH %d TILE_HEIGHT %d ==> Total %d\n", cid, NB_CLUSTER, N, TILE_WIDTH, TILE_HEIGHT, N*TILE_HEIGHT*TILE_WIDTH*sizeof(submatrix_a[0][0][0]));
-	uint64_t s0,s1,s2,s3,s4;
+#ifdef FFT_SERVICE
+static mppa_async_segment_t mailbox_segment;
+/* doorbell of the resident service, rung by the IO on every cluster */
+static long long command = 0;
+static off64_t command_offset = 0;
+
+/** @return non-zero if the buffers of the build can hold a @p width x
+ *  @p height matrix
+ */
+static int
+fft_size_valid(long long width, long long height)
+{
+	if (width < NB_CLUSTER || height < NB_CLUSTER || width > service_max_width || height > service_max_height)
+	{
+		return 0;
+	}
+	#ifdef FFT_INPLACE_TRANSPOSE
+	/* square matrix and equal bands */
+	if (width != height || width % NB_CLUSTER != 0)
+	{
+		return 0;
+	}
 	#endif
+	return 1;
+}
 
-	mppa_rpc_barrier_all();
+/** rebuild the set-up of this cluster in place for a @p width x @p height
+ *  matrix (FFT_CMD_RESIZE, see fft_size_valid()) and search a plan if the
+ *  IO has none for it
+ *  @return 0 on success, non-zero error code otherwise
+ */
+static int
+fft_resize(int width, int height)
+{
+	service_width = width;
+	service_height = height;
+	int wisdom_valid __attribute__((unused)) = fft_setup();
+	#ifdef FFT_AUTOTUNE
+	if (!wisdom_valid)
+	{
+		return fft_autotune();
+	}
+	#endif
+	return 0;
+}
 
-	mppa_async_event_t fence;
-	uint64_t start, end, total = 0;
+/** resident service: run the commands of the IO mailbox (fft_service.h)
+ *  until FFT_CMD_SHUTDOWN. The IO rings the doorbell of each cluster (adds
+ *  one to its command counter), which waits on its own counter instead of
+ *  polling the DDR. The LUTs, the plan and the segments stay set up from
+ *  one command to the next, FFT_CMD_RESIZE rebuilds them in place.
+ * @return 0 on success, non-zero error code otherwise
+ */
+static int
+fft_service(void)
+{
+	fft_mailbox_t mailbox;
+	long long seq = 0;
 	uint64_t comm = 0;
+	int err = 0;
+	if (group_rank == 0)
+	{
+		/* every cluster runs this binary: the counter has the same offset */
+		long long doorbell = command_offset;
+		mppa_async_put(&doorbell, &mailbox_segment, offsetof(fft_mailbox_t, doorbell), sizeof(doorbell), NULL);
+		mppa_async_fence(&mailbox_segment, NULL);
+	}
+	mppa_async_postadd(&mailbox_segment, offsetof(fft_mailbox_t, ready), 1);
+	while (1)
+	{
+		int rejected = 0;
+		seq++;
+		mppa_async_evalcond(&command, seq, MPPA_ASYNC_COND_GE, NULL);
+		mppa_async_get(&mailbox, &mailbox_segment, 0, sizeof(mailbox), NULL);
+		if (mailbox.cmd == FFT_CMD_EXECUTE || mailbox.cmd == FFT_CMD_RESIZE)
+		{
+			input_offset = mailbox.in_offset;
+			output_offset = mailbox.out_offset;
+			/* a request of another size resizes first, a size the buffers
+			 * cannot hold is rejected and the service goes on */
+			if (!fft_size_valid(mailbox.width, mailbox.height))
+			{
+				rejected = 1;
+			}else if (mailbox.cmd == FFT_CMD_RESIZE || mailbox.width != WIDTH || mailbox.height != HEIGHT)
+			{
+				err = fft_resize(mailbox.width, mailbox.height);
+			}
+		}
+		if (!err && !rejected && mailbox.cmd == FFT_CMD_EXECUTE)
+		{
+			err = fft_iterations(1, &comm);
+		}
+		if (rejected)
+		{
+			mppa_async_postadd(&mailbox_segment, offsetof(fft_mailbox_t, rejected), 1);
+		}
+		mppa_async_postadd(&mailbox_segment, offsetof(fft_mailbox_t, done), 1);
+		if (err || mailbox.cmd == FFT_CMD_SHUTDOWN)
+		{
+			return err;
+		}
+	}
+}
+#endif
+
+#ifdef FFT_MICROBENCH
+/** print a microbenchmark line (first cluster of the group): @p cycles
+ *  per call of a phase doing @p flops floating point operations and moving
+ *  @p bytes, against the peaks of @p nb_core PEs (FFT_BENCH_PEAK_FLOP,
+ *  FFT_BENCH_PEAK_SMEM) or, if @p dma, of the DMA of the cluster
+ *  (FFT_BENCH_PEAK_DMA). The phase is bound by the larger fraction.
+ */
+static void
+bench_report(const char *name, int size, int nb_core, uint64_t cycles, double flops, double bytes, int dma)
+{
+	double flop_cycle = flops/cycles;
+	double byte_cycle = bytes/cycles;
+	double compute = flop_cycle/(FFT_BENCH_PEAK_FLOP*nb_core);
+	double bandwidth = byte_cycle/(dma ? FFT_BENCH_PEAK_DMA : FFT_BENCH_PEAK_SMEM*nb_core);
+	if (group_rank == 0)
+	{
+		/* the DMAs of a cluster are issued by PE0 alone */
+		char cores[16];
+		if (dma)
+		{
+			snprintf(cores, sizeof(cores), "PE0");
+		}else
+		{
+			snprintf(cores, sizeof(cores), "%d", nb_core);
+		}
+		printf("Bench %s size %d cores %s cycles %llu GFLOP/s %.3f bytes/cycle %.3f compute %.1f%% bandwidth %.1f%% %s-bound\n",
+		       name, size, cores, (unsigned long long)cycles, flop_cycle*__bsp_frequency/1e9, byte_cycle,
+		       compute*100, bandwidth*100, compute > bandwidth ? "compute" : "bandwidth");
+	}
+}
 
+/** next PE count of the sweeps: powers of two, then NB_FFT_CORE */
+static int
+bench_next_core(int nb_core)
+{
+	return nb_core == NB_FFT_CORE ? NB_FFT_CORE + 1 : min(2*nb_core, NB_FFT_CORE);
+}
 
-	start = __k1_read_dsu_timestamp();
+/** radix-2 row FFTs (fft_radix2_float through ffts()) filling the tile:
+ *  5.n.log2(n) flops, every stage and the bit reversal read and write the
+ *  row once
+ */
+static void
+bench_ffts(void)
+{
+	cplx_float_t *tile = &submatrix_a[0][0][0];
+	const int area = TILE_HEIGHT*TILE_WIDTH;
+	int size, nb_core, i;
+	for (size = FFT_BENCH_MIN_SIZE; size <= min(area, FFT_BENCH_MAX_SIZE); size *= 4)
+	{
+		fft_row_plan_t *bench_plan = fft_row_plan_create(size, FFT_ROW_RADIX2);
+		int rows = area/size;
+		int log2_size = 0;
+		while ((1 << log2_size) < size) log2_size++;
+		memset(tile, 0, sizeof(cplx_float_t)*area);
+		for (nb_core = 1; nb_core <= NB_FFT_CORE; nb_core = bench_next_core(nb_core))
+		{
+			nb_fft_core = nb_core;
+			ffts(tile, bench_plan, rows, 0, FFT_CONJ_NONE, 0, 0, NULL, NULL);
+			uint64_t start = __k1_read_dsu_timestamp();
+			for (i = 0; i < FFT_BENCH_ITER; i++)
+			{
+				ffts(tile, bench_plan, rows, 0, FFT_CONJ_NONE, 0, 0, NULL, NULL);
+			}
+			uint64_t cycles = (__k1_read_dsu_timestamp() - start)/FFT_BENCH_ITER;
+			bench_report("fft_radix2_float", size, nb_core, cycles, 5.0*size*log2_size*rows,
+			             2.0*sizeof(cplx_float_t)*size*(log2_size + 1)*rows, 0);
+		}
+		fft_row_plan_destroy(bench_plan);
+	}
+	nb_fft_core = NB_FFT_CORE;
+}
+
+/** twiddle correction (twiddle_correction_) of the rows of the band,
+ *  @p size points per row: a complex product and a step of the recurrence
+ *  per point
+ */
+static void
+bench_twiddle(void)
+{
+	cplx_float_t *tile = &submatrix_a[0][0][0];
+	int size, nb_core, i;
+	for (size = FFT_BENCH_MIN_SIZE; size <= TILE_WIDTH; size *= 4)
+	{
+		memset(tile, 0, sizeof(cplx_float_t)*tile_height*size);
+		for (nb_core = 1; nb_core <= NB_FFT_CORE; nb_core = bench_next_core(nb_core))
+		{
+			nb_fft_core = nb_core;
+			twiddle_correction(tile, correction_twiddle_coef, tile_height, size);
+			uint64_t start = __k1_read_dsu_timestamp();
+			for (i = 0; i < FFT_BENCH_ITER; i++)
+			{
+				twiddle_correction(tile, correction_twiddle_coef, tile_height, size);
+			}
+			uint64_t cycles = (__k1_read_dsu_timestamp() - start)/FFT_BENCH_ITER;
+			bench_report("twiddle_correction", size, nb_core, cycles, 12.0*size*tile_height,
+			             2.0*sizeof(cplx_float_t)*size*tile_height, 0);
+		}
+	}
+	nb_fft_core = NB_FFT_CORE;
+}
+
+typedef struct{
+	const cplx_float_t *local;
+	cplx_float_t *target;
+	int size;
+	int first;
+	int height;
+}bench_block_t;
+
+static bench_block_t bench_block[NB_FFT_CORE];
+
+static void*
+bench_block_(void *args)
+{
+	bench_block_t *job = args;
+	__builtin_k1_dinval();
+	transpose_block(&job->local[job->first*job->size], job->target, job->size, job->size, NULL,
+	                sizeof(cplx_float_t), job->first, job->height, 0, 0, job->size);
+	__builtin_k1_wpurge();
+	__builtin_k1_fence();
+	return NULL;
+}
 
+/** local block of the transposes (transpose_block), a square of @p size
+ *  points per side from the tile to the transposed tile, the rows split
+ *  over @p nb_core PEs
+ */
+static void
+bench_transpose_block_run(int size, int nb_core)
+{
 	int i;
-	for(i=0;i<NB_FFT_ITER;i++)
+	for (i = 0; i < nb_core; i++)
 	{
-		uint64_t tmp_dsu = __k1_read_dsu_timestamp();
-		mppa_async_get_spaced(submatrix_a[buffer], &matrix_segment, cid*TILE_WIDTH*TILE_HEIGHT*sizeof(submatrix_a[0][0][0]), 
-					TILE_WIDTH*sizeof(submatrix_a[0][0][0]), TILE_HEIGHT, TILE_WIDTH*sizeof(submatrix_a[0][0][0]), NULL);
-		comm += __k1_read_dsu_timestamp() - tmp_dsu;
-
-		int err = flat_transpose(submatrix_a[buffer], submatrix_b[buffer]);
-        if (err) return err; 
-		#ifdef DEBUG_DUMP
-		dump_submatrix((void*)submatrix_b[buffer], TILE_WIDTH, TILE_HEIGHT);
-		s0 = __k1_read_dsu_timestamp();
-		#endif
+		bench_block[i].local = &submatrix_a[0][0][0];
+		bench_block[i].target = &TILE_B(0)[0][0];
+		bench_block[i].size = size;
+		bench_block[i].first = i*(size/nb_core) + min(i, size%nb_core);
+		bench_block[i].height = size/nb_core + (((size%nb_core) > i) ? 1 : 0);
+		if(i < nb_core-1)
+		{
+			pthread_create(&t[i], NULL, (void*)bench_block_, (void*)&bench_block[i]);  // PE1 -> PE(N-1)
+		}else
+		{
+			bench_block_((void*)&bench_block[i]); // PE0 work
+		}
+	}
+	for (i = 0; i < nb_core-1; i++)
+	{
+		pthread_join(t[i], NULL); // join PE1 -> PE(N-1)
+	}
+}
 
-		ffts((void*)submatrix_b[buffer], twiddle, lut, TILE_WIDTH);
-		#ifdef DEBUG_DUMP
-		dump_submatrix((void*)submatrix_b[buffer], TILE_WIDTH, TILE_HEIGHT);
-		s1 = __k1_read_dsu_timestamp();
-		#endif
+/** local transpose block: no flop, a read and a write per point */
+static void
+bench_transpose_block(void)
+{
+	const int area = min(TILE_HEIGHT*TILE_WIDTH, TILE_T_HEIGHT*TILE_T_WIDTH);
+	int size, nb_core, i;
+	for (size = FFT_BENCH_MIN_SIZE; size*size <= area; size *= 2)
+	{
+		for (nb_core = 1; nb_core <= NB_FFT_CORE; nb_core = bench_next_core(nb_core))
+		{
+			bench_transpose_block_run(size, nb_core);
+			uint64_t start = __k1_read_dsu_timestamp();
+			for (i = 0; i < FFT_BENCH_ITER; i++)
+			{
+				bench_transpose_block_run(size, nb_core);
+			}
+			uint64_t cycles = (__k1_read_dsu_timestamp() - start)/FFT_BENCH_ITER;
+			bench_report("transpose_block", size, nb_core, cycles, 0, 2.0*sizeof(cplx_float_t)*size*size, 0);
+		}
+	}
+}
 
-		err = flat_transpose(submatrix_b[buffer], submatrix_a[buffer]);
-        if (err) return err; 
-		#ifdef DEBUG_DUMP
-		dump_submatrix((void*)submatrix_a[buffer], TILE_WIDTH, TILE_HEIGHT);
-		s2 = __k1_read_dsu_timestamp();
-		#endif
+/** DMA patterns of flat_transpose() (FFT_DMA_COLUMN and FFT_DMA_ROW) on a
+ *  square matrix of @p size points per side, all the clusters of the group
+ *  together: each cluster sends its band once, bytes per cluster. In-place
+ *  builds have no target tile and time flat_transpose_inplace() instead, on
+ *  the WIDTH x HEIGHT matrix it is built for.
+ */
+static void
+bench_flat_transpose(void)
+{
+	int i;
+#ifdef FFT_INPLACE_TRANSPOSE
+	group_barrier();
+	flat_transpose_inplace(submatrix_a[0]);
+	group_barrier();
+	uint64_t start = __k1_read_dsu_timestamp();
+	for (i = 0; i < FFT_BENCH_ITER; i++)
+	{
+		flat_transpose_inplace(submatrix_a[0]);
+	}
+	uint64_t cycles = (__k1_read_dsu_timestamp() - start)/FFT_BENCH_ITER;
+	bench_report("flat_transpose_inplace", WIDTH, 1, cycles, 0, (double)sizeof(cplx_float_t)*WIDTH*tile_height, 1);
+#else
+	static const char *name[] = {"flat_transpose_column", "flat_transpose_row"};
+	int size, dma;
+	for (size = max(FFT_BENCH_MIN_SIZE, NB_CLUSTER); size <= min(WIDTH, HEIGHT); size *= 2)
+	{
+		for (dma = FFT_DMA_COLUMN; dma <= FFT_DMA_ROW; dma++)
+		{
+			group_barrier();
+			flat_transpose(submatrix_a[0], TILE_B(0), size, size, NULL, dma, sizeof(cplx_float_t), size, 0, size);
+			uint64_t start = __k1_read_dsu_timestamp();
+			for (i = 0; i < FFT_BENCH_ITER; i++)
+			{
+				flat_transpose(submatrix_a[0], TILE_B(0), size, size, NULL, dma, sizeof(cplx_float_t), size, 0, size);
+			}
+			uint64_t cycles = (__k1_read_dsu_timestamp() - start)/FFT_BENCH_ITER;
+			bench_report(name[dma], size, 1, cycles, 0, (double)sizeof(cplx_float_t)*size*BAND_SIZE(size, group_rank), 1);
+		}
+	}
+#endif
+}
 
-		twiddle_correction((void*)submatrix_a[buffer]);
-		#ifdef DEBUG_DUMP
-		dump_submatrix((void*)submatrix_a[buffer], TILE_WIDTH, TILE_HEIGHT);
-		s3 = __k1_read_dsu_timestamp();
-		#endif
+/** run every microbenchmark on its own, before the timed iterations. The
+ *  tiles are scratch here, the iterations fetch their input again.
+ */
+static void
+fft_microbench(void)
+{
+	bench_ffts();
+	bench_twiddle();
+	bench_transpose_block();
+	bench_flat_transpose();
+	group_barrier();
+}
+#endif
 
-		ffts((void*)submatrix_a[buffer], twiddle, lut, TILE_WIDTH);
-		#ifdef DEBUG_DUMP
-		dump_submatrix((void*)submatrix_a[buffer], TILE_WIDTH, TILE_HEIGHT);
-		s4 = __k1_read_dsu_timestamp();
-		#endif
+/* main on PE 0, argv: group index and first cluster of the group (none
+ * when the binary runs alone on the NB_CLUSTER first clusters) */
+int main(int argc, char *argv[])
+{
+	mppa_rpc_client_init();
+	mppa_async_init();
+	mppa_remote_client_init();
+
+	if (argc >= 3)
+	{
+		group_id = atoi(argv[1]);
+		group_first = atoi(argv[2]);
+	}
+	group_rank = __k1_get_cluster_id() - group_first;
+	int cid = group_rank;
+	int buffer __attribute__((unused)) = 0;
+
+	mppa_async_segment_clone(&matrix_segment, GROUP_SEGMENT_ID(MATRIX_SEGMENT_ID, group_id), 0, 0, NULL); // input fft samples
+	#ifdef FFT_SERVICE
+	/* one pool holds the input and output buffers of the requests */
+	matrix_segment_out = matrix_segment;
+	#else
+	mppa_async_segment_clone(&matrix_segment_out, GROUP_SEGMENT_ID(MATRIX_SEGMENT_ID+1, group_id), 0, 0, NULL); // input fft samples
+	#endif
+	mppa_async_segment_clone(&plan_segment, GROUP_SEGMENT_ID(PLAN_SEGMENT_ID, group_id), 0, 0, NULL); // wisdom / autotuned plan
+	#if FFT_MODE == FFT_MODE_CONV
+	mppa_async_segment_clone(&filter_segment, GROUP_SEGMENT_ID(FILTER_SEGMENT_ID, group_id), 0, 0, NULL); // filter spectrum
+	#endif
+	#ifdef FFT_SERVICE
+	mppa_async_segment_clone(&mailbox_segment, GROUP_SEGMENT_ID(MAILBOX_SEGMENT_ID, group_id), 0, 0, NULL); // service commands
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), (void*)&command, &command_offset);
+	#endif
 
-		err = flat_transpose(submatrix_a[buffer], submatrix_b[buffer]);
-        if (err) return err; 
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), (void*)&go, &go_offset);
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), (void*)&barrier_count, &barrier_offset);
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), (void*)block_count, &block_offset);
+	/* the only chip wide barrier: every cluster is up before the group
+	 * barriers and transposes access it */
+	mppa_rpc_barrier_all();
+
+	#ifdef FFT_SERVICE
+	/* first matrix served and its buffers, set by the IO before the spawn */
+	fft_mailbox_t mailbox;
+	mppa_async_get(&mailbox, &mailbox_segment, 0, sizeof(mailbox), NULL);
+	if (!fft_size_valid(mailbox.width, mailbox.height))
+	{
+		printf("Cluster %d cannot serve %lld x %lld, the buffers hold %d x %d\n", cid, mailbox.width,
+		       mailbox.height, service_max_width, service_max_height);
+		mOS_exit(1,-1);
+	}
+	service_width = mailbox.width;
+	service_height = mailbox.height;
+	input_offset = mailbox.in_offset;
+	output_offset = mailbox.out_offset;
+	#endif
+	int wisdom_valid __attribute__((unused)) = fft_setup();
+	if(cid == 0)
+	{
+		printf("# Cluster %d SMEM tile buffers %d KB (%s transpose, %d buffer(s))\n", cid,
+		       (int)(SMEM_TILE_FOOTPRINT/1024), SMEM_TRANSPOSE_MODE, N);
+	}
 
-		tmp_dsu = __k1_read_dsu_timestamp();
-		mppa_async_put_spaced(submatrix_b[buffer], &matrix_segment_out, cid*TILE_WIDTH*TILE_HEIGHT*sizeof(submatrix_a[0][0][0]), 
-					TILE_WIDTH*sizeof(submatrix_a[0][0][0]), TILE_HEIGHT, TILE_WIDTH*sizeof(submatrix_a[0][0][0]), &fence);
-		mppa_async_fence(&matrix_segment, &fence);
-		mppa_async_event_wait(&fence);
-		comm += __k1_read_dsu_timestamp() - tmp_dsu;
+	#ifdef DEBUG_DUMP
+	group_barrier();
+	if(cid == 0)
+	{
+		printf("# MPPA - NB_CLUSTER %d in-chip flat FFT %d points. Matrix dim: %d %d. Matrix size: %d\n", NB_CLUSTER, WIDTH*HEIGHT, WIDTH, HEIGHT, WIDTH*HEIGHT*sizeof(submatrix_a[0][0][0]));
+	}
+	group_barrier();
+
+	printf("# Cluster %d NB_CLUSTER %d N %d TILE_WIDTH %d TILE_HEIGHT %d ==> Total %d\n", cid, NB_CLUSTER, N, TILE_WIDTH, TILE_HEIGHT, N*TILE_HEIGHT*TILE_WIDTH*sizeof(submatrix_a[0][0][0]));
+	#endif
+
+	group_barrier();
+
+	#ifdef FFT_MICROBENCH
+	fft_microbench();
+	#endif
 
-		mppa_rpc_barrier_all();
+	#ifdef FFT_AUTOTUNE
+	if (!wisdom_valid)
+	{
+		int err = fft_autotune();
+		if (err) return err;
 	}
+	#endif
+
+	#ifdef FFT_SERVICE
+	/* resident: the IO times the requests */
+	int err_service = fft_service();
+	group_barrier();
+	mppa_async_final();
+	return err_service;
+	#endif
+
+	uint64_t start, end, total = 0;
+	uint64_t comm = 0;
+
+	#if FFT_MODE == FFT_MODE_CONV
+	/* reference: forward FFT, DDR round trip, product and inverse FFT */
+	conv_fused = 0;
+	start = __k1_read_dsu_timestamp();
+	int err_unfused = fft_iterations(NB_FFT_ITER, &comm);
+	if (err_unfused) return err_unfused;
+	float unfused_ms = (float)(__k1_read_dsu_timestamp() - start)/((float)__bsp_frequency/1000.0f)/NB_FFT_ITER;
+	conv_fused = 1;
+	comm = 0;
+	#endif
+
+	start = __k1_read_dsu_timestamp();
+
+	int err = fft_iterations(NB_FFT_ITER, &comm);
+	if (err) return err;
 
 	end = __k1_read_dsu_timestamp();
 
@@ -370,7 +2001,7 @@ int main(void/*unused*/)
 	/* write backresult */
 
 	#ifdef DEBUG_DUMP
-	dump_submatrix(submatrix_b[buffer], WIDTH, HEIGHT);
+	dump_submatrix((void*)TILE_B(buffer), WIDTH, HEIGHT);
 	#endif
 
 	#define CHIP_FREQ ((float)__bsp_frequency/1000.0f)
@@ -386,19 +2017,19 @@ int main(void/*unused*/)
 	float nb_bytes = (float)(sizeof(submatrix_a[0][0][0])*WIDTH*HEIGHT*2);
 	float bw_gbs = (nb_bytes/1000000000.0f) / (time_ms/1000);
 	printf("# Cluster %d nb_job_dma %d cycle %lld time_ms %.4f ms Total in-chip memory bandwidth %.3f GB/s\n", cid, nb_job_dma, total, time_ms, bw_gbs);
-	mppa_rpc_barrier_all();
+	group_barrier();
 	float transpose_time_ms = (float)transpose_time/CHIP_FREQ;
 	float ffts_time_ms = (float)ffts_time/CHIP_FREQ;
 	float twiddle_time_ms = (float)twiddle_time/CHIP_FREQ;
-	mppa_rpc_barrier_all();
+	group_barrier();
 	printf("# Cluster %d total %.3f ms transpose %.3f ms (%.1f) ffts %.3f ms (%.1f) twiddle %.3f ms (%.1f) \n", cid, time_ms, transpose_time_ms, transpose_time_ms/time_ms*100.0f, ffts_time_ms, ffts_time_ms/time_ms*100.0f, twiddle_time_ms, twiddle_time_ms/time_ms*100.0f);
 	#endif
 	static float com_average[NB_CLUSTER];
 	off64_t off;
-	mppa_async_offset(MPPA_ASYNC_SMEM_0, &com_average[__k1_get_cluster_id()], &off);
-	mppa_async_put(&comm_ms, MPPA_ASYNC_SMEM_0, off, sizeof(comm_ms), NULL);
-	mppa_async_fence(MPPA_ASYNC_SMEM_0, NULL);
-	mppa_rpc_barrier_all();
+	mppa_async_offset(mppa_async_default_segment(GROUP_CLUSTER(0)), &com_average[cid], &off);
+	mppa_async_put(&comm_ms, mppa_async_default_segment(GROUP_CLUSTER(0)), off, sizeof(comm_ms), NULL);
+	mppa_async_fence(mppa_async_default_segment(GROUP_CLUSTER(0)), NULL);
+	group_barrier();
 	if(cid == 0)
 	{
 		comm_ms = 0;
@@ -407,9 +2038,13 @@ int main(void/*unused*/)
 			comm_ms += com_average[i];
 		}
 		comm_ms /= NB_CLUSTER;
-		printf("Freq %.1f MHz %d Cluster(s) %d Core(s) FFT %d x %d = %d Total Time %.2f ms Comm. Time %.2f ms Compute Time %.2f ms - %.1f FFT / s\n", CHIP_FREQ/1000, NB_CLUSTER, N_CORES, WIDTH, HEIGHT, WIDTH*HEIGHT, time_ms, comm_ms, time_ms-comm_ms, 1/time_ms*1000);
+		printf("Freq %.1f MHz %d Cluster(s) %d Core(s) FFT %d x %d = %d Total Time %.2f ms Comm. Time %.2f ms Compute Time %.2f ms - %.1f FFT / s Bitrev %s PE/row %d DMA %s Kernels %s/%s Mode %s Window %s Output %s Input %d Bins %d+%d Group %d Clusters %d-%d Order %s Pipeline %s\n", CHIP_FREQ/1000, NB_CLUSTER, N_CORES, WIDTH, HEIGHT, WIDTH*HEIGHT, time_ms, comm_ms, time_ms-comm_ms, 1/time_ms*1000, plan.kernel == FFT_KERNEL_RADIX2_DIF ? "fused" : "separate", ffts_pe_per_row(tile_height, row_plan), plan.dma == FFT_DMA_ROW ? "row" : "column", row_kind_name[col_plan->kind], row_kind_name[row_plan->kind], fft_mode_name[FFT_MODE], fft_window_name[FFT_WINDOW], fft_output_name[FFT_OUTPUT], FFT_INPUT_POINTS, FFT_OUTPUT_FIRST, FFT_OUTPUT_POINTS, group_id, GROUP_CLUSTER(0), GROUP_CLUSTER(NB_CLUSTER-1), fft_order_name[FFT_ORDER], FFT_PIPELINE ? "on" : "off");
+		#if FFT_MODE == FFT_MODE_CONV
+		printf("Convolution fused %.2f ms - %.1f conv / s unfused %.2f ms - %.1f conv / s speedup %.2f\n",
+		       time_ms, 1/time_ms*1000, unfused_ms, 1/unfused_ms*1000, unfused_ms/time_ms);
+		#endif
 	}
-	mppa_rpc_barrier_all();
+	group_barrier();
 	mppa_async_final();
 	return 0;
 }
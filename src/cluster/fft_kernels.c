@@ -25,6 +25,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <utask.h>
 #include <HAL/hal/hal_ext.h>
 #include <mOS_vcore_u.h>
@@ -74,8 +75,6 @@ fft_radix2_get_twiddle_float(int size)
 	return twiddle;
 }
 
-static int fft_radix_count_bit_reverse = 0;
-
 int*
 fft_radix2_get_bitreverse(int size)
 {
@@ -111,12 +110,13 @@ fft_radix2_get_bitreverse(int size)
 		j += k;
 
 	}
-	fft_radix_count_bit_reverse = count;
 	if(count >= size)
 	{
 		printf("fft_radix2_get_bitreverse failed\n");
 		mOS_exit(1,-1);
 	}
+	/* end of the swap list, lets several sizes coexist */
+	lut[count] = -1;
 	return lut;
 }
 
@@ -125,7 +125,7 @@ fft_radix2_float(cplx_float_t * restrict in, const float *twiddle, const int *ar
 {
 	int i=0, j, k, m;
 	uint64_t dword;
-	for (i=0;i<fft_radix_count_bit_reverse;i+=2)
+	for (i=0;array_bit_reverse[i]>=0;i+=2)
 	{
 		dword								= in[array_bit_reverse[i+0]].dword;
 		in[array_bit_reverse[i+0]].dword	= in[array_bit_reverse[i+1]].dword;
@@ -159,16 +159,302 @@ fft_radix2_float(cplx_float_t * restrict in, const float *twiddle, const int *ar
 	}
 }
 
+int*
+fft_radix2_get_bitreverse_index(int size)
+{
+	int *rev = NULL;
+	posix_memalign((void**)&rev, 64, size*sizeof(*rev));
+	if(rev == NULL)
+	{
+		printf("Cluster %d fft_radix2_get_bitreverse_index failed to alloc lut\n", __k1_get_cluster_id());
+		mOS_exit(1,-1);
+	}
+	int i, b, nb_bit = 0;
+	while ((1 << nb_bit) < size)
+	{
+		nb_bit++;
+	}
+	for (i = 0; i < size; i++)
+	{
+		int r = 0;
+		for (b = 0; b < nb_bit; b++)
+		{
+			r |= ((i >> b) & 1) << (nb_bit-1-b);
+		}
+		rev[i] = r;
+	}
+	return rev;
+}
+
+int
+fft_radix2_get_bitreverse_count(const int *array_bit_reverse)
+{
+	int count = 0;
+	while (array_bit_reverse[count] >= 0)
+	{
+		count++;
+	}
+	return count;
+}
+
+void
+fft_radix2_float_bitreverse(cplx_float_t * restrict in, const int *array_bit_reverse, const int first, const int last)
+{
+	int i;
+	uint64_t dword;
+	for (i=first;i<last;i+=2)
+	{
+		dword								= in[array_bit_reverse[i+0]].dword;
+		in[array_bit_reverse[i+0]].dword	= in[array_bit_reverse[i+1]].dword;
+		in[array_bit_reverse[i+1]].dword	= dword;
+	}
+}
+
+void
+fft_radix2_float_stages(cplx_float_t * restrict in, const float *twiddle, const int size,
+                        const int m_first, const int m_last, const int b_first, const int b_last)
+{
+	int m, b;
+	int lh = 0;
+	/* log2(m_first/2) */
+	for (m = 2; m < m_first; m *= 2)
+	{
+		lh++;
+	}
+	for (m = m_first; m <= m_last; m *= 2, lh++)
+	{
+		/* twiddles of one stage are stored contiguously: size/2 complex values */
+		const float *tw = &twiddle[lh*size];
+		const int half = m >> 1;
+		for (b = b_first; b < b_last; b++)
+		{
+			const int lo = ((b >> lh) << (lh+1)) + (b & (half-1));
+			const int hi = lo + half;
+
+			register float x_reel = tw[2*b+0];
+			register float x_im = tw[2*b+1];
+
+			register float t_reel = x_reel * in[hi].x - x_im * in[hi].y;
+			register float t_im   = x_reel * in[hi].y + x_im * in[hi].x;
+
+			register float u_reel = in[lo].x;
+			register float u_im   = in[lo].y;
+
+			in[lo].x = u_reel + t_reel;
+			in[lo].y = u_im   + t_im;
+
+			in[hi].x = u_reel - t_reel;
+			in[hi].y = u_im   - t_im;
+		}
+	}
+}
+
+void
+fft_radix2_float_dif_stages(cplx_float_t * restrict in, const float *twiddle, const int size,
+                            const int m_first, const int m_last, const int b_first, const int b_last)
+{
+	int m, b;
+	int lh = 0;
+	/* log2(m_first/2) */
+	for (m = 2; m < m_first; m *= 2)
+	{
+		lh++;
+	}
+	for (m = m_first; m >= m_last; m /= 2, lh--)
+	{
+		const float *tw = &twiddle[lh*size];
+		const int half = m >> 1;
+		for (b = b_first; b < b_last; b++)
+		{
+			const int lo = ((b >> lh) << (lh+1)) + (b & (half-1));
+			const int hi = lo + half;
+
+			register float x_reel = tw[2*b+0];
+			register float x_im = tw[2*b+1];
+
+			register float u_reel = in[lo].x;
+			register float u_im   = in[lo].y;
+			register float v_reel = in[hi].x;
+			register float v_im   = in[hi].y;
+
+			register float d_reel = u_reel - v_reel;
+			register float d_im   = u_im   - v_im;
+
+			in[lo].x = u_reel + v_reel;
+			in[lo].y = u_im   + v_im;
+
+			in[hi].x = x_reel * d_reel - x_im * d_im;
+			in[hi].y = x_reel * d_im   + x_im * d_reel;
+		}
+	}
+}
+
+void
+fft_radix2_float_dif(cplx_float_t * restrict in, const float *twiddle, const int size)
+{
+	fft_radix2_float_dif_stages(in, twiddle, size, size, 2, 0, size/2);
+}
+
+/** w_size^e = exp(-2i.pi.e/size), 0 <= e < size, read from the last stage
+ *  of a fft_radix2_get_twiddle_float() table (@p tw, size/2 values)
+ */
+static inline void
+fft_radix2_twiddle_pow(const float *tw, const int size, const int e, float *c, float *s)
+{
+	if (e < size/2)
+	{
+		*c = tw[2*e+0];
+		*s = tw[2*e+1];
+	}else
+	{
+		*c = -tw[2*(e-size/2)+0];
+		*s = -tw[2*(e-size/2)+1];
+	}
+}
+
+/** @return the @p bits low bits of @p b in reverse order */
+static int
+fft_bit_reverse(int b, int bits)
+{
+	int r = 0;
+	int i;
+	for (i = 0; i < bits; i++)
+	{
+		r = (r << 1) | ((b >> i) & 1);
+	}
+	return r;
+}
+
+/** @return log2 of the power of two @p size */
+static int
+fft_log2(int size)
+{
+	int lg = 0;
+	while ((1 << lg) < size)
+	{
+		lg++;
+	}
+	return lg;
+}
+
+void
+fft_radix2_float_dif_pruned(cplx_float_t * restrict in, const float *twiddle, const int size, const int live)
+{
+	int p = 1, k = 0;
+	int b, j;
+	if (live <= 0)
+	{
+		memset(in, 0, size*sizeof(*in));
+		return;
+	}
+	/* the first k stages only see the first size/2^k points non-zero */
+	while (live <= size/(2*p))
+	{
+		p *= 2;
+		k++;
+	}
+	const int bs = size/p;
+	const float *tw = &twiddle[(fft_log2(size)-1)*size];
+	for (j = live; j < bs; j++)
+	{
+		in[j].dword = 0;
+	}
+	/* after k stages, block b holds x[j].w^(j.rev(b)): fill the blocks from
+	 * the first one, which is left as is (rev(0) = 0) */
+	for (b = p-1; b >= 1; b--)
+	{
+		const int r = fft_bit_reverse(b, k);
+		cplx_float_t *blk = &in[b*bs];
+		int e = 0;
+		for (j = 0; j < bs; j++, e += r)
+		{
+			float c, s;
+			fft_radix2_twiddle_pow(tw, size, e, &c, &s);
+			blk[j].x = in[j].x * c - in[j].y * s;
+			blk[j].y = in[j].x * s + in[j].y * c;
+		}
+	}
+	if (bs >= 2)
+	{
+		fft_radix2_float_dif_stages(in, twiddle, size, bs, 2, 0, size/2);
+	}
+}
+
+void
+fft_radix2_float_pruned_out(cplx_float_t * restrict in, const float *twiddle, const int *array_bit_reverse,
+                            const int size, const int first, const int last)
+{
+	int p, best_p = 1, best_cost = fft_log2(size);
+	int k = 0, b, q, o;
+	/* cost per point: half a complex product per remaining stage and one
+	 * per combined block */
+	for (p = 2; p <= size && p <= FFT_PRUNE_MAX_BLOCK; p *= 2)
+	{
+		const int bs = size/p;
+		const int cost = fft_log2(bs) + 2*((last-1)/bs - first/bs + 1);
+		if (cost < best_cost)
+		{
+			best_cost = cost;
+			best_p = p;
+		}
+	}
+	p = best_p;
+	const int bs = size/p;
+	fft_radix2_float_bitreverse(in, array_bit_reverse, 0, fft_radix2_get_bitreverse_count(array_bit_reverse));
+	if (bs >= 2)
+	{
+		fft_radix2_float_stages(in, twiddle, size, 2, bs, 0, size/2);
+	}
+	if (p == 1)
+	{
+		return;
+	}
+	/* block b holds the FFT Y_b of the samples rev(b) mod p, the last k
+	 * stages are only evaluated for the blocks of [first, last):
+	 * X[o.bs + q] = sum_b w^(rev(b).(o.bs + q)) Y_b[q] */
+	const float *tw = &twiddle[(fft_log2(size)-1)*size];
+	const int o_first = first/bs;
+	const int o_last = (last-1)/bs + 1;
+	int rev[FFT_PRUNE_MAX_BLOCK];
+	cplx_float_t x[FFT_PRUNE_MAX_BLOCK];
+	k = fft_log2(p);
+	for (b = 0; b < p; b++)
+	{
+		rev[b] = fft_bit_reverse(b, k);
+	}
+	for (q = 0; q < bs; q++)
+	{
+		for (o = o_first; o < o_last; o++)
+		{
+			const int n = o*bs + q;
+			float acc_x = 0.f, acc_y = 0.f;
+			for (b = 0; b < p; b++)
+			{
+				float c, s;
+				fft_radix2_twiddle_pow(tw, size, (rev[b]*n) & (size-1), &c, &s);
+				acc_x += in[b*bs + q].x * c - in[b*bs + q].y * s;
+				acc_y += in[b*bs + q].x * s + in[b*bs + q].y * c;
+			}
+			x[o-o_first].x = acc_x;
+			x[o-o_first].y = acc_y;
+		}
+		for (o = o_first; o < o_last; o++)
+		{
+			in[o*bs + q] = x[o-o_first];
+		}
+	}
+}
+
 float*
-fft_get_correction_twiddle(int w, int h)
+fft_get_correction_twiddle(int w, int h, int cid)
 {
-	int cid = __k1_get_cluster_id();
-	int i_base = cid * (TILE_HEIGHT);
+	int height = BAND_SIZE(h, cid);
+	int i_base = BAND_START(h, cid);
 	float *correction_twiddle = NULL;
-	posix_memalign((void**)&correction_twiddle, 64, sizeof(*correction_twiddle)*TILE_HEIGHT*2);
+	posix_memalign((void**)&correction_twiddle, 64, sizeof(*correction_twiddle)*height*2);
 	assert(correction_twiddle != NULL && "correction_twiddle alloc failed\n");
 	int i, j=0;
-	for(i=0;i<TILE_HEIGHT;i++)
+	for(i=0;i<height;i++)
 	{
 		float omega_c = (float) cos(2*M_PI*((float)(i+i_base))/((float)(w*h)));
 		float omega_s = (float)-sin(2*M_PI*((float)(i+i_base))/((float)(w*h)));
@@ -180,3 +466,292 @@ fft_get_correction_twiddle(int w, int h)
 	return correction_twiddle;
 }
 
+
+static void*
+fft_alloc(size_t size, const char *what)
+{
+	void *p = NULL;
+	posix_memalign(&p, 64, size);
+	if(p == NULL)
+	{
+		printf("Cluster %d failed to alloc %s (%d bytes)\n", __k1_get_cluster_id(), what, (int)size);
+		mOS_exit(1,-1);
+	}
+	return p;
+}
+
+/** split @p size into radices 4, 2, 3, 5 and 7
+ *  @return the number of factors, 0 if another prime factor remains
+ */
+static int
+fft_row_factorize(int size, int *factor)
+{
+	static const int radix[] = {4, 2, 3, 5, 7};
+	int nb_factor = 0, r;
+	for (r = 0; r < (int)(sizeof(radix)/sizeof(radix[0])); r++)
+	{
+		while (size % radix[r] == 0 && nb_factor < FFT_ROW_MAX_FACTOR)
+		{
+			factor[nb_factor++] = radix[r];
+			size /= radix[r];
+		}
+	}
+	return size == 1 ? nb_factor : 0;
+}
+
+/** fill the Stockham stage twiddles of a mixed-radix plan: for the stage of
+ *  radix p working on sub-transforms of n points (m = n/p),
+ *  w[q*(p-1) + k-1] = exp(-2i.pi.q.k/n) for q < m and 0 < k < p
+ */
+static void
+fft_row_mixed_init(fft_row_plan_t *plan)
+{
+	int f, q, k, n = plan->size, nb_twiddle = 0;
+	for (f = 0; f < plan->nb_factor; f++)
+	{
+		nb_twiddle += (plan->factor[f]-1)*(n/plan->factor[f]);
+		n /= plan->factor[f];
+	}
+	plan->stage_twiddle = fft_alloc(sizeof(cplx_float_t)*(nb_twiddle > 0 ? nb_twiddle : 1), "stage twiddles");
+	cplx_float_t *w = plan->stage_twiddle;
+	n = plan->size;
+	for (f = 0; f < plan->nb_factor; f++)
+	{
+		int p = plan->factor[f], m = n/p;
+		for (q = 0; q < m; q++)
+		{
+			for (k = 1; k < p; k++)
+			{
+				w->x = (float)cos(2*M_PI*(double)(q*k)/(double)n);
+				w->y = (float)-sin(2*M_PI*(double)(q*k)/(double)n);
+				w++;
+			}
+		}
+		n = m;
+	}
+	for (f = 3; f <= FFT_ROW_MAX_RADIX; f += 2)
+	{
+		for (k = 0; k < f; k++)
+		{
+			plan->root_cos[f][k] = (float)cos(2*M_PI*(double)k/(double)f);
+			plan->root_sin[f][k] = (float)sin(2*M_PI*(double)k/(double)f);
+		}
+	}
+	plan->work_size = plan->size;
+}
+
+/** Bluestein: X[k] = w[k] . sum_n (x[n].w[n]) conj(w[k-n]), w[n] = exp(-i.pi.n^2/size).
+ *  The convolution is done with radix-2 FFTs of bs_size >= 2.size-1 points,
+ *  the transform of the conj(w) chirp (scaled by 1/bs_size) is precomputed.
+ */
+static void
+fft_row_bluestein_init(fft_row_plan_t *plan)
+{
+	int n, m = 1;
+	while (m < 2*plan->size-1)
+	{
+		m *= 2;
+	}
+	plan->bs_size = m;
+	plan->twiddle = fft_radix2_get_twiddle_float(m);
+	plan->lut = fft_radix2_get_bitreverse(m);
+	plan->chirp = fft_alloc(sizeof(cplx_float_t)*plan->size, "bluestein chirp");
+	plan->filter = fft_alloc(sizeof(cplx_float_t)*m, "bluestein filter");
+	for (n = 0; n < plan->size; n++)
+	{
+		/* n^2 mod 2.size keeps the angle accurate for large n */
+		long long n2 = ((long long)n*n) % (2LL*plan->size);
+		plan->chirp[n].x = (float)cos(M_PI*(double)n2/(double)plan->size);
+		plan->chirp[n].y = (float)-sin(M_PI*(double)n2/(double)plan->size);
+	}
+	for (n = 0; n < m; n++)
+	{
+		plan->filter[n].dword = 0;
+	}
+	for (n = 0; n < plan->size; n++)
+	{
+		plan->filter[n].x = plan->chirp[n].x/m;
+		plan->filter[n].y = -plan->chirp[n].y/m;
+		if (n > 0)
+		{
+			plan->filter[m-n] = plan->filter[n];
+		}
+	}
+	fft_radix2_float(plan->filter, plan->twiddle, plan->lut, m);
+	plan->work_size = m;
+}
+
+fft_row_plan_t*
+fft_row_plan_create(int size, int pow2_kind)
+{
+	fft_row_plan_t *plan = fft_alloc(sizeof(*plan), "row plan");
+	memset(plan, 0, sizeof(*plan));
+	plan->size = size;
+	if ((size & (size-1)) == 0 && pow2_kind == FFT_ROW_RADIX2)
+	{
+		plan->kind = FFT_ROW_RADIX2;
+		plan->twiddle = fft_radix2_get_twiddle_float(size);
+		plan->lut = fft_radix2_get_bitreverse(size);
+		plan->rev = fft_radix2_get_bitreverse_index(size);
+	}else if ((plan->nb_factor = fft_row_factorize(size, plan->factor)) > 0)
+	{
+		plan->kind = FFT_ROW_MIXED;
+		fft_row_mixed_init(plan);
+	}else
+	{
+		plan->kind = FFT_ROW_BLUESTEIN;
+		fft_row_bluestein_init(plan);
+	}
+	__builtin_k1_wpurge();
+	return plan;
+}
+
+void
+fft_row_plan_destroy(fft_row_plan_t *plan)
+{
+	free(plan->twiddle);
+	free(plan->lut);
+	free(plan->rev);
+	free(plan->stage_twiddle);
+	free(plan->chirp);
+	free(plan->filter);
+	free(plan);
+}
+
+/** one Stockham stage of radix @p p: x holds s interleaved sub-transforms
+ *  of n = p.m points, y receives s.p interleaved sub-transforms of m points
+ */
+static void
+fft_row_mixed_stage(const fft_row_plan_t *plan, const cplx_float_t * restrict x, cplx_float_t * restrict y,
+                    const cplx_float_t *w, int p, int m, int s)
+{
+	int q, j, k, r;
+	cplx_float_t a[FFT_ROW_MAX_RADIX], b[FFT_ROW_MAX_RADIX];
+	for (q = 0; q < m; q++)
+	{
+		const cplx_float_t *wq = &w[q*(p-1)];
+		for (j = 0; j < s; j++)
+		{
+			for (r = 0; r < p; r++)
+			{
+				a[r] = x[j + s*(q + m*r)];
+			}
+			if (p == 2)
+			{
+				b[0].x = a[0].x + a[1].x; b[0].y = a[0].y + a[1].y;
+				b[1].x = a[0].x - a[1].x; b[1].y = a[0].y - a[1].y;
+			}else if (p == 4)
+			{
+				float s02_x = a[0].x + a[2].x, s02_y = a[0].y + a[2].y;
+				float d02_x = a[0].x - a[2].x, d02_y = a[0].y - a[2].y;
+				float s13_x = a[1].x + a[3].x, s13_y = a[1].y + a[3].y;
+				float d13_x = a[1].x - a[3].x, d13_y = a[1].y - a[3].y;
+				b[0].x = s02_x + s13_x; b[0].y = s02_y + s13_y;
+				b[2].x = s02_x - s13_x; b[2].y = s02_y - s13_y;
+				/* -i.d13 = (d13.y, -d13.x) */
+				b[1].x = d02_x + d13_y; b[1].y = d02_y - d13_x;
+				b[3].x = d02_x - d13_y; b[3].y = d02_y + d13_x;
+			}else
+			{
+				/* odd prime: pair a[r] with a[p-r] to halve the multiplications */
+				for (k = 1; k <= p/2; k++)
+				{
+					float sum_x = a[0].x, sum_y = a[0].y, rot_x = 0, rot_y = 0;
+					for (r = 1; r <= p/2; r++)
+					{
+						float c = plan->root_cos[p][(r*k)%p];
+						float sn = plan->root_sin[p][(r*k)%p];
+						sum_x += (a[r].x + a[p-r].x)*c;
+						sum_y += (a[r].y + a[p-r].y)*c;
+						rot_x += (a[r].x - a[p-r].x)*sn;
+						rot_y += (a[r].y - a[p-r].y)*sn;
+					}
+					b[k].x = sum_x + rot_y;   b[k].y = sum_y - rot_x;
+					b[p-k].x = sum_x - rot_y; b[p-k].y = sum_y + rot_x;
+				}
+				b[0] = a[0];
+				for (r = 1; r < p; r++)
+				{
+					b[0].x += a[r].x;
+					b[0].y += a[r].y;
+				}
+			}
+			y[j + s*p*q] = b[0];
+			for (k = 1; k < p; k++)
+			{
+				y[j + s*(p*q + k)].x = b[k].x * wq[k-1].x - b[k].y * wq[k-1].y;
+				y[j + s*(p*q + k)].y = b[k].x * wq[k-1].y + b[k].y * wq[k-1].x;
+			}
+		}
+	}
+}
+
+static void
+fft_row_mixed(const fft_row_plan_t *plan, cplx_float_t * restrict in, cplx_float_t * restrict work)
+{
+	int f, n = plan->size, s = 1;
+	const cplx_float_t *w = plan->stage_twiddle;
+	cplx_float_t *x = in, *y = work;
+	for (f = 0; f < plan->nb_factor; f++)
+	{
+		int p = plan->factor[f], m = n/p;
+		fft_row_mixed_stage(plan, x, y, w, p, m, s);
+		w += (p-1)*m;
+		cplx_float_t *tmp = x; x = y; y = tmp;
+		n = m;
+		s *= p;
+	}
+	if (x != in)
+	{
+		memcpy(in, x, sizeof(*in)*plan->size);
+	}
+}
+
+static void
+fft_row_bluestein(const fft_row_plan_t *plan, cplx_float_t * restrict in, cplx_float_t * restrict work)
+{
+	int n;
+	const cplx_float_t *w = plan->chirp;
+	for (n = 0; n < plan->size; n++)
+	{
+		work[n].x = in[n].x * w[n].x - in[n].y * w[n].y;
+		work[n].y = in[n].x * w[n].y + in[n].y * w[n].x;
+	}
+	for (; n < plan->bs_size; n++)
+	{
+		work[n].dword = 0;
+	}
+	fft_radix2_float(work, plan->twiddle, plan->lut, plan->bs_size);
+	/* product with the chirp filter, conjugated for the inverse FFT */
+	for (n = 0; n < plan->bs_size; n++)
+	{
+		float x = work[n].x * plan->filter[n].x - work[n].y * plan->filter[n].y;
+		float y = work[n].x * plan->filter[n].y + work[n].y * plan->filter[n].x;
+		work[n].x = x;
+		work[n].y = -y;
+	}
+	fft_radix2_float(work, plan->twiddle, plan->lut, plan->bs_size);
+	for (n = 0; n < plan->size; n++)
+	{
+		/* conj(work) . w */
+		in[n].x = work[n].x * w[n].x + work[n].y * w[n].y;
+		in[n].y = work[n].x * w[n].y - work[n].y * w[n].x;
+	}
+}
+
+void
+fft_row_execute(const fft_row_plan_t *plan, cplx_float_t * restrict in, cplx_float_t * restrict work)
+{
+	switch (plan->kind)
+	{
+	case FFT_ROW_RADIX2:
+		fft_radix2_float(in, plan->twiddle, plan->lut, plan->size);
+		break;
+	case FFT_ROW_MIXED:
+		fft_row_mixed(plan, in, work);
+		break;
+	default:
+		fft_row_bluestein(plan, in, work);
+		break;
+	}
+}
@@ -0,0 +1,302 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Kalray S.A
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "fft_host.h"
+
+/* maximum number of buffers registered at the same time */
+#define FFT_HOST_MAX_REGION (64)
+/* alignment of the mirrors in the pool */
+#define FFT_HOST_POOL_ALIGN (64)
+
+/* offsets in the window */
+#define FFT_HOST_SQ(slot) (offsetof(fft_queue_window_t, queue.sq) + (slot)*sizeof(fft_queue_desc_t))
+#define FFT_HOST_CQ(slot) (offsetof(fft_queue_window_t, queue.cq) + (slot)*sizeof(fft_queue_desc_t))
+
+typedef struct
+{
+	char *buf;
+	size_t size;
+	uint64_t addr;	/* mirror in the pool */
+}fft_host_region_t;
+
+struct fft_host
+{
+	const fft_host_transport_t *transport;
+	void *ctx;
+	/* pool and matrices of the engine, read at open */
+	fft_queue_window_t window;
+	fft_host_region_t region[FFT_HOST_MAX_REGION];
+	int nb_region;
+	int next_id;
+	int pending;
+	/* counters only the host writes */
+	uint32_t sq_tail;
+	uint32_t cq_head;
+	/* per ring slot: request in flight, its id, user pointer and output */
+	int busy[FFT_QUEUE_DEPTH];
+	int id[FFT_QUEUE_DEPTH];
+	void *user[FFT_QUEUE_DEPTH];
+	cplx_float_t *out[FFT_QUEUE_DEPTH];
+	int size[FFT_QUEUE_DEPTH];
+};
+
+fft_host_t*
+fft_host_open(const fft_host_transport_t *transport, void *arg)
+{
+	fft_host_t *host = calloc(1, sizeof(*host));
+	if (host == NULL)
+	{
+		printf("# [HOST] failed to allocate fft_host_t\n");
+		return NULL;
+	}
+	host->transport = transport;
+	if (transport->open(&host->ctx, arg) != 0)
+	{
+		printf("# [HOST] failed to open transport %s\n", transport->name);
+		free(host);
+		return NULL;
+	}
+	if (transport->read(host->ctx, 0, &host->window, sizeof(host->window)) != 0)
+	{
+		printf("# [HOST] failed to read the window of transport %s\n", transport->name);
+		transport->close(host->ctx);
+		free(host);
+		return NULL;
+	}
+	host->sq_tail = host->window.queue.sq_tail;
+	host->cq_head = host->window.queue.cq_head;
+	return host;
+}
+
+void
+fft_host_close(fft_host_t *host)
+{
+	fft_host_completion_t c;
+	long long shutdown = 1;
+	while (fft_host_wait(host, &c));
+	while (host->nb_region > 0)
+	{
+		fft_host_unregister(host, host->region[host->nb_region-1].buf);
+	}
+	/* the rings are empty, the engine stops on this doorbell */
+	host->transport->write(host->ctx, offsetof(fft_queue_window_t, shutdown), &shutdown, sizeof(shutdown));
+	host->transport->doorbell(host->ctx);
+	host->transport->close(host->ctx);
+	free(host);
+}
+
+/** first fit of @p size bytes in the pool, around the mirrors of the
+ *  registered buffers
+ *  @return 0 on success, -1 if the pool has no room left
+ */
+static int
+fft_host_pool_alloc(fft_host_t *host, size_t size, uint64_t *addr)
+{
+	const uint64_t align = FFT_HOST_POOL_ALIGN;
+	const uint64_t end = (uint64_t)host->window.pool_size;
+	uint64_t first = ((uint64_t)host->window.pool_first + align-1) & ~(align-1);
+	int i, moved = 1;
+	if (size > end)
+	{
+		return -1;
+	}
+	/* past every mirror overlapping it, until none does */
+	while (moved)
+	{
+		moved = 0;
+		for (i = 0; i < host->nb_region; i++)
+		{
+			const fft_host_region_t *r = &host->region[i];
+			if (first < r->addr + r->size && r->addr < first + size)
+			{
+				first = (r->addr + r->size + align-1) & ~(align-1);
+				moved = 1;
+			}
+		}
+	}
+	if (first > end - size)
+	{
+		return -1;
+	}
+	*addr = first;
+	return 0;
+}
+
+int
+fft_host_register(fft_host_t *host, void *buf, size_t size)
+{
+	if (host->nb_region == FFT_HOST_MAX_REGION)
+	{
+		printf("# [HOST] too many registered buffers (max %d)\n", FFT_HOST_MAX_REGION);
+		return -1;
+	}
+	fft_host_region_t *r = &host->region[host->nb_region];
+	if (fft_host_pool_alloc(host, size, &r->addr) != 0)
+	{
+		printf("# [HOST] no room for %zu bytes in the pool of transport %s\n", size, host->transport->name);
+		return -1;
+	}
+	r->buf = buf;
+	r->size = size;
+	host->nb_region++;
+	return 0;
+}
+
+int
+fft_host_unregister(fft_host_t *host, void *buf)
+{
+	int i;
+	for (i = 0; i < host->nb_region; i++)
+	{
+		if (host->region[i].buf == buf)
+		{
+			host->region[i] = host->region[host->nb_region-1];
+			host->nb_region--;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/** translate [buf, buf+size) in a device address
+ *  @return 0 on success, -1 if it is not inside a registered buffer
+ */
+static int
+fft_host_translate(fft_host_t *host, const void *buf, size_t size, uint64_t *addr)
+{
+	const char *p = buf;
+	int i;
+	for (i = 0; i < host->nb_region; i++)
+	{
+		fft_host_region_t *r = &host->region[i];
+		/* offsets, not end pointers: no overflow past the region */
+		if (p >= r->buf && p < r->buf + r->size && size <= r->size - (size_t)(p - r->buf))
+		{
+			*addr = r->addr + (uint64_t)(p - r->buf);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+int
+fft_host_submit(fft_host_t *host, const cplx_float_t *in, cplx_float_t *out,
+                int size, void *user)
+{
+	fft_queue_desc_t desc;
+	int width, height, slot;
+
+	memset(&desc, 0, sizeof(desc));
+	if (size <= 0 || fft_queue_split(&host->window, size, &width, &height) != 0)
+	{
+		return -3;
+	}
+	if (fft_host_translate(host, in, size*sizeof(*in), &desc.in_addr) != 0 ||
+	    fft_host_translate(host, out, size*sizeof(*out), &desc.out_addr) != 0)
+	{
+		return -1;
+	}
+	/* the completion ring must be able to hold every request in flight */
+	if (host->pending == FFT_QUEUE_DEPTH)
+	{
+		return -2;
+	}
+	for (slot = 0; host->busy[slot]; slot++);
+
+	/* input, then the descriptor, then the tail that publishes it */
+	desc.id = slot;
+	desc.size = size;
+	uint32_t tail = host->sq_tail + 1;
+	if (host->transport->pool_write(host->ctx, desc.in_addr, in, size*sizeof(*in)) != 0 ||
+	    host->transport->write(host->ctx, FFT_HOST_SQ(host->sq_tail % FFT_QUEUE_DEPTH), &desc, sizeof(desc)) != 0 ||
+	    host->transport->write(host->ctx, offsetof(fft_queue_window_t, queue.sq_tail), &tail, sizeof(tail)) != 0)
+	{
+		return -4;
+	}
+	host->sq_tail = tail;
+
+	host->busy[slot] = 1;
+	host->id[slot] = host->next_id;
+	host->user[slot] = user;
+	host->out[slot] = out;
+	host->size[slot] = size;
+	host->next_id = (host->next_id + 1) & 0x7fffffff;
+	host->pending++;
+
+	host->transport->doorbell(host->ctx);
+	return host->id[slot];
+}
+
+int
+fft_host_poll(fft_host_t *host, fft_host_completion_t *c)
+{
+	fft_queue_desc_t desc;
+	uint32_t tail;
+	/* no access to the window while nothing is in flight */
+	if (host->pending == 0 ||
+	    host->transport->read(host->ctx, offsetof(fft_queue_window_t, queue.cq_tail), &tail, sizeof(tail)) != 0 ||
+	    tail == host->cq_head ||
+	    host->transport->read(host->ctx, FFT_HOST_CQ(host->cq_head % FFT_QUEUE_DEPTH), &desc, sizeof(desc)) != 0)
+	{
+		return 0;
+	}
+	int slot = desc.id;
+	c->id = host->id[slot];
+	c->status = desc.status;
+	c->user = host->user[slot];
+	if (desc.status == FFT_QUEUE_STATUS_OK &&
+	    host->transport->pool_read(host->ctx, desc.out_addr, host->out[slot],
+	                               host->size[slot]*sizeof(cplx_float_t)) != 0)
+	{
+		c->status = FFT_QUEUE_STATUS_EIO;
+	}
+	host->busy[slot] = 0;
+	host->pending--;
+	host->cq_head++;
+	host->transport->write(host->ctx, offsetof(fft_queue_window_t, queue.cq_head), &host->cq_head, sizeof(host->cq_head));
+	return 1;
+}
+
+int
+fft_host_wait(fft_host_t *host, fft_host_completion_t *c)
+{
+	while (host->pending > 0)
+	{
+		if (fft_host_poll(host, c))
+		{
+			return 1;
+		}
+		host->transport->wait_irq(host->ctx);
+	}
+	return 0;
+}
+
+int
+fft_host_pending(const fft_host_t *host)
+{
+	return host->pending;
+}
@@ -0,0 +1,331 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Kalray S.A
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/* Host emulator of the board behind fft_host_transport_pcie.
+ *
+ * The window (rings, doorbell and sample pool) lives in a POSIX shared
+ * memory object, like it does in the DDR of the IO, and the host library
+ * reaches it through the same read/write/doorbell accesses. A thread
+ * stands in for the IO and the clusters: it serves the rings like the IO
+ * does (host_queue_run() of io_main.c), with the same checks of the
+ * requests, and computes each one in the pool with a host radix-2 FFT in
+ * place of the 6-step of the clusters.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include "fft_host.h"
+
+/* sample pool of the emulated board (shared memory pages are only
+ * allocated when touched) */
+#define FFT_EMU_POOL_SIZE ((size_t)256 << 20)
+/* largest matrix side of the emulated engine */
+#define FFT_EMU_MAX_SIDE (4096)
+
+typedef struct
+{
+	fft_queue_window_t window;
+	sem_t doorbell;		/* host -> engine */
+	sem_t irq;		/* engine -> host */
+}fft_emu_shared_t;
+
+typedef struct
+{
+	fft_emu_shared_t *shared;
+	char *pool;
+	size_t map_size;
+	pthread_t engine;
+	int twiddle_size;
+	cplx_float_t *twiddle;
+}fft_emu_t;
+
+/** in-place radix-2 forward FFT, the twiddles of @p size are cached
+ *  @return 0 on success, -1 if the twiddles cannot be allocated
+ */
+static int
+fft_emu_fft(fft_emu_t *emu, cplx_float_t *in, int size)
+{
+	int i, j, k, m;
+	if (emu->twiddle_size != size)
+	{
+		free(emu->twiddle);
+		emu->twiddle_size = 0;
+		emu->twiddle = malloc(sizeof(*emu->twiddle)*(size/2));
+		if (emu->twiddle == NULL)
+		{
+			return -1;
+		}
+		for (i = 0; i < size/2; i++)
+		{
+			emu->twiddle[i].x = (float)cos(2*M_PI*(double)i/(double)size);
+			emu->twiddle[i].y = (float)-sin(2*M_PI*(double)i/(double)size);
+		}
+		emu->twiddle_size = size;
+	}
+	/* bit reversal */
+	for (i = 0, j = 0; i < size-1; i++)
+	{
+		if (i < j)
+		{
+			uint64_t dword = in[i].dword;
+			in[i].dword = in[j].dword;
+			in[j].dword = dword;
+		}
+		k = size >> 1;
+		while (k <= j)
+		{
+			j -= k;
+			k >>= 1;
+		}
+		j += k;
+	}
+	for (m = 2; m <= size; m *= 2)
+	{
+		int stride = size/m;
+		for (k = 0; k < size; k += m)
+		{
+			for (j = 0; j < m/2; j++)
+			{
+				cplx_float_t w = emu->twiddle[j*stride];
+				cplx_float_t *u = &in[k + j];
+				cplx_float_t *v = &in[k + j + m/2];
+				float t_reel = w.x * v->x - w.y * v->y;
+				float t_im   = w.x * v->y + w.y * v->x;
+				v->x = u->x - t_reel;
+				v->y = u->y - t_im;
+				u->x = u->x + t_reel;
+				u->y = u->y + t_im;
+			}
+		}
+	}
+	return 0;
+}
+
+/** run the request @p desc in the pool, as the IO would
+ *  @return its FFT_QUEUE_STATUS_*
+ */
+static int
+fft_emu_execute(fft_emu_t *emu, const fft_queue_desc_t *desc)
+{
+	const fft_queue_window_t *window = &emu->shared->window;
+	int width, height;
+	if (!fft_queue_desc_valid(window, desc) || fft_queue_split(window, desc->size, &width, &height) != 0)
+	{
+		return FFT_QUEUE_STATUS_EINVAL;
+	}
+	cplx_float_t *in = (cplx_float_t*)(emu->pool + desc->in_addr);
+	cplx_float_t *out = (cplx_float_t*)(emu->pool + desc->out_addr);
+	if (in != out)
+	{
+		memmove(out, in, sizeof(*out)*desc->size);
+	}
+	return fft_emu_fft(emu, out, desc->size) == 0 ? FFT_QUEUE_STATUS_OK : FFT_QUEUE_STATUS_EINVAL;
+}
+
+static void*
+fft_emu_engine(void *arg)
+{
+	fft_emu_t *emu = arg;
+	fft_emu_shared_t *shared = emu->shared;
+	fft_queue_t *q = &shared->window.queue;
+	uint32_t head = 0, tail = 0;
+	while (1)
+	{
+		sem_wait(&shared->doorbell);
+		while (head != __atomic_load_n(&q->sq_tail, __ATOMIC_ACQUIRE))
+		{
+			fft_queue_desc_t desc = q->sq[head % FFT_QUEUE_DEPTH];
+			__atomic_store_n(&q->sq_head, ++head, __ATOMIC_RELEASE);
+			desc.status = fft_emu_execute(emu, &desc);
+			q->cq[tail % FFT_QUEUE_DEPTH] = desc;
+			__atomic_store_n(&q->cq_tail, ++tail, __ATOMIC_RELEASE);
+			sem_post(&shared->irq);
+		}
+		if (__atomic_load_n(&shared->window.shutdown, __ATOMIC_ACQUIRE))
+		{
+			break;
+		}
+	}
+	return NULL;
+}
+
+static int
+fft_emu_open(void **ctx, void *arg)
+{
+	char name[64];
+	(void)arg;
+	snprintf(name, sizeof(name), "/fft_emu.%d", (int)getpid());
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+	{
+		perror("# [HOST] shm_open");
+		return -1;
+	}
+	/* nobody else attaches, the object lives as long as the mapping */
+	shm_unlink(name);
+	size_t map_size = sizeof(fft_emu_shared_t) + FFT_EMU_POOL_SIZE;
+	if (ftruncate(fd, map_size) != 0)
+	{
+		perror("# [HOST] ftruncate");
+		close(fd);
+		return -1;
+	}
+	fft_emu_shared_t *shared = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shared == MAP_FAILED)
+	{
+		perror("# [HOST] mmap");
+		return -1;
+	}
+	sem_init(&shared->doorbell, 1, 0);
+	sem_init(&shared->irq, 1, 0);
+	/* what the IO publishes: the whole pool is left to the host, any
+	 * power of two up to the largest matrix */
+	fft_queue_window_t *window = &shared->window;
+	window->pool_first = 0;
+	window->pool_size = FFT_EMU_POOL_SIZE;
+	window->min_side = 1;
+	window->max_width = FFT_EMU_MAX_SIDE;
+	window->max_height = FFT_EMU_MAX_SIDE;
+	window->flags = FFT_QUEUE_POW2;
+
+	fft_emu_t *emu = calloc(1, sizeof(*emu));
+	if (emu == NULL)
+	{
+		munmap(shared, map_size);
+		return -1;
+	}
+	emu->shared = shared;
+	emu->pool = (char*)(shared + 1);
+	emu->map_size = map_size;
+	if (pthread_create(&emu->engine, NULL, fft_emu_engine, emu) != 0)
+	{
+		munmap(shared, map_size);
+		free(emu);
+		return -1;
+	}
+	__atomic_store_n(&window->ready, 1, __ATOMIC_RELEASE);
+	*ctx = emu;
+	return 0;
+}
+
+static void
+fft_emu_close(void *ctx)
+{
+	fft_emu_t *emu = ctx;
+	/* the host rang the doorbell of the shutdown */
+	pthread_join(emu->engine, NULL);
+	sem_destroy(&emu->shared->doorbell);
+	sem_destroy(&emu->shared->irq);
+	munmap(emu->shared, emu->map_size);
+	free(emu->twiddle);
+	free(emu);
+}
+
+static int
+fft_emu_read(void *ctx, size_t offset, void *buf, size_t size)
+{
+	fft_emu_t *emu = ctx;
+	if (offset > sizeof(fft_queue_window_t) || size > sizeof(fft_queue_window_t) - offset)
+	{
+		return -1;
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	memcpy(buf, (char*)&emu->shared->window + offset, size);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return 0;
+}
+
+static int
+fft_emu_write(void *ctx, size_t offset, const void *buf, size_t size)
+{
+	fft_emu_t *emu = ctx;
+	if (offset > sizeof(fft_queue_window_t) || size > sizeof(fft_queue_window_t) - offset)
+	{
+		return -1;
+	}
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy((char*)&emu->shared->window + offset, buf, size);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return 0;
+}
+
+static int
+fft_emu_pool_read(void *ctx, uint64_t addr, void *buf, size_t size)
+{
+	fft_emu_t *emu = ctx;
+	if (addr > FFT_EMU_POOL_SIZE || size > FFT_EMU_POOL_SIZE - addr)
+	{
+		return -1;
+	}
+	memcpy(buf, emu->pool + addr, size);
+	return 0;
+}
+
+static int
+fft_emu_pool_write(void *ctx, uint64_t addr, const void *buf, size_t size)
+{
+	fft_emu_t *emu = ctx;
+	if (addr > FFT_EMU_POOL_SIZE || size > FFT_EMU_POOL_SIZE - addr)
+	{
+		return -1;
+	}
+	memcpy(emu->pool + addr, buf, size);
+	return 0;
+}
+
+static void
+fft_emu_doorbell(void *ctx)
+{
+	fft_emu_t *emu = ctx;
+	__atomic_add_fetch(&emu->shared->window.doorbell, 1, __ATOMIC_RELEASE);
+	sem_post(&emu->shared->doorbell);
+}
+
+static void
+fft_emu_wait_irq(void *ctx)
+{
+	fft_emu_t *emu = ctx;
+	sem_wait(&emu->shared->irq);
+}
+
+const fft_host_transport_t fft_host_transport_emu =
+{
+	.name = "emu",
+	.open = fft_emu_open,
+	.close = fft_emu_close,
+	.read = fft_emu_read,
+	.write = fft_emu_write,
+	.pool_read = fft_emu_pool_read,
+	.pool_write = fft_emu_pool_write,
+	.doorbell = fft_emu_doorbell,
+	.wait_irq = fft_emu_wait_irq,
+};
@@ -0,0 +1,191 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Kalray S.A
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/* PCIe transport: the board booted by host_main.c, its IO serving the host
+ * queue (host_queue=1, host_queue_run() of io_main.c).
+ *
+ * The window (FFT_QUEUE_SEGMENT_ID) and the sample pool are segments of the
+ * DDR of the IO, which the host reaches through the remote server the IO
+ * starts on its PCIe interface (mppa_remote_server_init()): reads and
+ * writes are remote gets and puts, the doorbell a remote add on which the
+ * IO waits. The board raises no completion interrupt, wait_irq() polls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <mppa_remote.h>
+#include <mppa_async.h>
+#include "fft_host.h"
+
+/* period of the polls of the window, in us */
+#define FFT_PCIE_POLL_US (10)
+
+typedef struct
+{
+	mppa_async_segment_t window;
+	mppa_async_segment_t pool;
+	uint64_t pool_size;
+}fft_pcie_t;
+
+/** clone segment @p id, created by the IO once it is up
+ *  @return 0 on success, -1 if it does not show up
+ */
+static int
+fft_pcie_clone(mppa_async_segment_t *segment, int id)
+{
+	int retry;
+	for (retry = 0; retry < 1000000/FFT_PCIE_POLL_US; retry++)
+	{
+		if (mppa_async_segment_clone(segment, id, 0, 0, NULL) == 0)
+		{
+			return 0;
+		}
+		usleep(FFT_PCIE_POLL_US);
+	}
+	printf("# [HOST] segment %d of the IO not found\n", id);
+	return -1;
+}
+
+static int
+fft_pcie_open(void **ctx, void *arg)
+{
+	fft_queue_window_t window;
+	(void)arg;
+	fft_pcie_t *pcie = calloc(1, sizeof(*pcie));
+	if (pcie == NULL)
+	{
+		return -1;
+	}
+	mppa_async_init();
+	mppa_remote_client_init();
+	if (fft_pcie_clone(&pcie->window, FFT_QUEUE_SEGMENT_ID) != 0)
+	{
+		free(pcie);
+		return -1;
+	}
+	/* the IO sets the window up, then ready */
+	while (1)
+	{
+		if (mppa_async_get(&window, &pcie->window, 0, sizeof(window), NULL) != 0)
+		{
+			free(pcie);
+			return -1;
+		}
+		if (window.ready)
+		{
+			break;
+		}
+		usleep(FFT_PCIE_POLL_US);
+	}
+	if (fft_pcie_clone(&pcie->pool, (int)window.pool_segment) != 0)
+	{
+		free(pcie);
+		return -1;
+	}
+	pcie->pool_size = (uint64_t)window.pool_size;
+	*ctx = pcie;
+	return 0;
+}
+
+static void
+fft_pcie_close(void *ctx)
+{
+	mppa_async_final();
+	free(ctx);
+}
+
+static int
+fft_pcie_read(void *ctx, size_t offset, void *buf, size_t size)
+{
+	fft_pcie_t *pcie = ctx;
+	return mppa_async_get(buf, &pcie->window, offset, size, NULL) == 0 ? 0 : -1;
+}
+
+static int
+fft_pcie_write(void *ctx, size_t offset, const void *buf, size_t size)
+{
+	fft_pcie_t *pcie = ctx;
+	/* ordered: a descriptor lands before the tail that publishes it */
+	if (mppa_async_put(buf, &pcie->window, offset, size, NULL) != 0 ||
+	    mppa_async_fence(&pcie->window, NULL) != 0)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+static int
+fft_pcie_pool_read(void *ctx, uint64_t addr, void *buf, size_t size)
+{
+	fft_pcie_t *pcie = ctx;
+	if (addr > pcie->pool_size || size > pcie->pool_size - addr)
+	{
+		return -1;
+	}
+	return mppa_async_get(buf, &pcie->pool, addr, size, NULL) == 0 ? 0 : -1;
+}
+
+static int
+fft_pcie_pool_write(void *ctx, uint64_t addr, const void *buf, size_t size)
+{
+	fft_pcie_t *pcie = ctx;
+	if (addr > pcie->pool_size || size > pcie->pool_size - addr)
+	{
+		return -1;
+	}
+	if (mppa_async_put(buf, &pcie->pool, addr, size, NULL) != 0 ||
+	    mppa_async_fence(&pcie->pool, NULL) != 0)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+static void
+fft_pcie_doorbell(void *ctx)
+{
+	fft_pcie_t *pcie = ctx;
+	mppa_async_postadd(&pcie->window, offsetof(fft_queue_window_t, doorbell), 1);
+}
+
+static void
+fft_pcie_wait_irq(void *ctx)
+{
+	(void)ctx;
+	usleep(FFT_PCIE_POLL_US);
+}
+
+const fft_host_transport_t fft_host_transport_pcie =
+{
+	.name = "pcie",
+	.open = fft_pcie_open,
+	.close = fft_pcie_close,
+	.read = fft_pcie_read,
+	.write = fft_pcie_write,
+	.pool_read = fft_pcie_pool_read,
+	.pool_write = fft_pcie_pool_write,
+	.doorbell = fft_pcie_doorbell,
+	.wait_irq = fft_pcie_wait_irq,
+};
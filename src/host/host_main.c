@@ -25,6 +25,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <pcie.h>
+#ifdef FFT_HOST_QUEUE
+#include "host_stream.h"
+#endif
 
 int main(int argc, char **argv)
 {
@@ -54,6 +57,11 @@ int main(int argc, char **argv)
 	#endif
 	int status;
 	int local_status = 0;
+	#ifdef FFT_HOST_QUEUE
+	/* stream FFTs through the rings the IO serves, argv after the
+	 * binaries as for host_emu */
+	local_status = host_stream(&fft_host_transport_pcie, NULL, argc > 3 ? argc - 2 : 1, argc > 3 ? argv + 2 : argv);
+	#endif
 	#ifdef DEBUG_DUMP
 	printf("# [HOST] waits\n");	
 	#endif
@@ -68,5 +76,5 @@ int main(int argc, char **argv)
 	#ifdef DEBUG_DUMP
 	printf("# [HOST] Goodbye\n");
 	#endif
- 	return 0;
+ 	return local_status ? -1 : 0;
 }
@@ -0,0 +1,280 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Kalray S.A
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Streams forward FFTs through the asynchronous host interface, over the
+ * board (host_bin, host_queue=1) or the emulator (host_emu).
+ *
+ * arguments: [size] [nb_request] [nb_buffer] [vectors.fftv]
+ *
+ * With a test-vector file (written by the IO, see fft_vectors.h) the input
+ * is mapped from the file instead of drawn with rand(), and every bin is
+ * checked against the reference of the file when it is a plain forward FFT.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fft_host.h"
+#include "fft_vectors.h"
+#include "host_stream.h"
+
+/** Error threshold for comparison between computed value and reference */
+#define TEST_THRESHOLD (0.1)
+
+/** double precision reference DFT of bin @p k */
+static void
+dft_bin(const cplx_float_t *in, int size, int k, double *re, double *im)
+{
+	int n;
+	*re = 0;
+	*im = 0;
+	for (n = 0; n < size; n++)
+	{
+		double a = -2*M_PI*(double)(((long long)n*k) % size)/(double)size;
+		*re += in[n].x*cos(a) - in[n].y*sin(a);
+		*im += in[n].x*sin(a) + in[n].y*cos(a);
+	}
+}
+
+/** check a few bins of @p out against the reference DFT of @p in
+ *  @return the number of bins exceeding TEST_THRESHOLD
+ */
+static int
+check_bins(const cplx_float_t *in, const cplx_float_t *out, int size)
+{
+	int diff = 0, i;
+	for (i = 0; i < 16; i++)
+	{
+		int k = (int)(((long long)i*7919) % size);
+		double re, im;
+		dft_bin(in, size, k, &re, &im);
+		if (fabs(re - out[k].x) > TEST_THRESHOLD || fabs(im - out[k].y) > TEST_THRESHOLD ||
+		    isnan(out[k].x) || isnan(out[k].y))
+		{
+			diff++;
+		}
+	}
+	return diff;
+}
+
+/** compare every bin of @p out with @p reference
+ *  @return the number of bins exceeding TEST_THRESHOLD
+ */
+static int
+check_reference(const cplx_float_t *reference, const cplx_float_t *out, int size)
+{
+	int diff = 0, k;
+	for (k = 0; k < size; k++)
+	{
+		if (fabs(reference[k].x - out[k].x) > TEST_THRESHOLD || fabs(reference[k].y - out[k].y) > TEST_THRESHOLD ||
+		    isnan(out[k].x) || isnan(out[k].y))
+		{
+			diff++;
+		}
+	}
+	return diff;
+}
+
+/** map the test-vector file @p path read-only
+ *  @param[out] map_size size of the mapping
+ *  @param[out] size number of points of the input
+ *  @return the header followed by the points, NULL on error
+ */
+static const fft_vectors_header_t*
+vectors_map(const char *path, size_t *map_size, int *size)
+{
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(fft_vectors_header_t))
+	{
+		printf("ERROR: failed to open test-vector file %s\n", path);
+		if (fd >= 0) close(fd);
+		return NULL;
+	}
+	const fft_vectors_header_t *header = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (header == MAP_FAILED)
+	{
+		perror("# [HOST] mmap");
+		return NULL;
+	}
+	*map_size = st.st_size;
+	*size = header->width*header->height;
+	if (header->magic != FFT_VECTORS_MAGIC || header->version != FFT_VECTORS_VERSION ||
+	    header->nb_reference < 0 || header->nb_reference > FFT_VECTORS_MAX_REFERENCE ||
+	    *map_size < fft_vectors_record_offset(*size, header->nb_reference))
+	{
+		printf("ERROR: %s is not a test-vector file\n", path);
+		munmap((void*)header, st.st_size);
+		return NULL;
+	}
+	return header;
+}
+
+int
+host_stream(const fft_host_transport_t *transport, void *arg, int argc, char **argv)
+{
+	int size = argc > 1 ? atoi(argv[1]) : 65536;
+	int nb_request = argc > 2 ? atoi(argv[2]) : 256;
+	int nb_buffer = argc > 3 ? atoi(argv[3]) : 8;
+	int i;
+
+	/* one request in flight per buffer pair, the rings bound them */
+	if (nb_buffer < 1 || nb_buffer > FFT_QUEUE_DEPTH)
+	{
+		printf("ERROR: the number of buffers must be in range [1,%d]\n", FFT_QUEUE_DEPTH);
+		return -1;
+	}
+
+	/* test vectors: the size is the one of the file */
+	const fft_vectors_header_t *vectors = NULL;
+	const cplx_float_t *vectors_input = NULL;
+	const cplx_float_t *reference = NULL;
+	size_t vectors_size = 0;
+	if (argc > 4)
+	{
+		vectors = vectors_map(argv[4], &vectors_size, &size);
+		if (vectors == NULL)
+		{
+			return -1;
+		}
+		vectors_input = (const cplx_float_t*)(vectors + 1);
+		/* the reference of a forward FFT without window (FFT_MODE_FORWARD,
+		 * FFT_WINDOW_NONE) */
+		uint64_t key = fft_vectors_key(vectors_input, vectors->width, vectors->height, 0, 0, 0, NULL, 0);
+		for (i = 0; i < vectors->nb_reference; i++)
+		{
+			const fft_vectors_record_t *record = (const fft_vectors_record_t*)
+				((const char*)vectors + fft_vectors_record_offset(size, i));
+			if (record->key == key)
+			{
+				reference = (const cplx_float_t*)(record + 1);
+				break;
+			}
+		}
+		printf("# [HOST] test vectors %s: %d x %d, %s\n", argv[4], vectors->width, vectors->height,
+		       reference ? "reference loaded" : "no forward reference, sampled DFT check");
+	}
+
+	fft_host_t *host = fft_host_open(transport, arg);
+	if (host == NULL)
+	{
+		return -1;
+	}
+
+	/* one allocation holding every input and output, registered once;
+	 * the engine stops when the host is closed, on errors as well */
+	size_t buffer_size = sizeof(cplx_float_t)*size;
+	cplx_float_t *pool = NULL;
+	if (posix_memalign((void**)&pool, 1<<13, 2*nb_buffer*buffer_size) != 0)
+	{
+		printf("ERROR: failed to allocate buffers\n");
+		fft_host_close(host);
+		return -1;
+	}
+	if (fft_host_register(host, pool, 2*nb_buffer*buffer_size) != 0)
+	{
+		printf("ERROR: failed to register buffers\n");
+		fft_host_close(host);
+		free(pool);
+		return -1;
+	}
+	for (i = 0; i < nb_buffer*size; i++)
+	{
+		if (vectors_input)
+		{
+			pool[i] = vectors_input[i % size];
+		}else
+		{
+			pool[i].x = (float)rand()/(RAND_MAX/32);
+			pool[i].y = 0.0f;
+		}
+	}
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	int submitted = 0, completed = 0, diff = 0, err = 0;
+	fft_host_completion_t c;
+	while (!err && completed < nb_request)
+	{
+		/* keep one request in flight per buffer pair */
+		while (!err && submitted < nb_request && fft_host_pending(host) < nb_buffer)
+		{
+			int b = submitted % nb_buffer;
+			int id = fft_host_submit(host, &pool[b*size], &pool[(nb_buffer+b)*size], size,
+			                        (void*)(uintptr_t)b);
+			if (id < 0)
+			{
+				printf("ERROR: submit failed (%d)\n", id);
+				err = 1;
+				break;
+			}
+			submitted++;
+		}
+		if (!fft_host_wait(host, &c))
+		{
+			break;
+		}
+		if (c.status != FFT_QUEUE_STATUS_OK)
+		{
+			printf("ERROR: request %d failed with status %d\n", c.id, c.status);
+			err = 1;
+			break;
+		}
+		/* verify the first completion of each buffer */
+		if (completed < nb_buffer)
+		{
+			int b = (int)(uintptr_t)c.user;
+			if (reference)
+			{
+				diff += check_reference(reference, &pool[(nb_buffer+b)*size], size);
+			}else
+			{
+				diff += check_bins(&pool[b*size], &pool[(nb_buffer+b)*size], size);
+			}
+		}
+		completed++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	double time_ms = (t1.tv_sec - t0.tv_sec)*1e3 + (t1.tv_nsec - t0.tv_nsec)/1e6;
+	if (!err)
+	{
+		printf("# [HOST] %s FFT %d points %d requests %d buffers Total Time %.2f ms - %.1f FFT / s %s\n",
+		       transport->name, size, nb_request, nb_buffer, time_ms, nb_request/time_ms*1000, diff ? "FAILED" : "SUCCESS");
+	}
+
+	fft_host_close(host);
+	free(pool);
+	if (vectors)
+	{
+		munmap((void*)vectors, vectors_size);
+	}
+	return diff || err ? -1 : 0;
+}
@@ -32,12 +32,25 @@
 #include <HAL/hal/board/boot_args.h>
 #include <mppa_async.h>
 #include <math.h>
+#include <string.h>
+#include <stddef.h>
+#include <vbsp.h>
 #include "config.h"
 #include "fft_kernels.h"
+#include "fft_plan.h"
+#include "fft_vectors.h"
+#include "fft_service.h"
+#include "fft_queue.h"
 
 
 /** Error threshold for comparison between computed value and reference */
 #define TEST_THRESHOLD (0.1)
+/** Extra error threshold relative to the peak magnitude (non power of two sizes) */
+#define TEST_REL_THRESHOLD (2e-6)
+/** Extra error threshold relative to the peak magnitude for the dB output:
+ *  a float dB value keeps about 1e-6 of the relative precision of the
+ *  magnitude */
+#define TEST_DB_REL_THRESHOLD (4e-6)
 
 void
 fft_radix_2_float_reference(cplx_float_t *in, int len)
@@ -102,144 +115,1195 @@ fft_radix_2_float_reference(cplx_float_t *in, int len)
     }
 }
 
+/** recursive decimation in time on the smallest prime factor of @p len,
+ *  double precision, out of place
+ */
+static void
+fft_mixed_reference_(const double *in, int stride, int len, double *out)
+{
+    int p, r, k, q;
+    if (len == 1)
+    {
+        out[0] = in[0];
+        out[1] = in[1];
+        return;
+    }
+    for (p = 2; len % p != 0; p++);
+    int m = len / p;
+    for (r = 0; r < p; r++)
+    {
+        fft_mixed_reference_(&in[2*r*stride], stride*p, m, &out[2*r*m]);
+    }
+    double *tmp = malloc(sizeof(double)*2*len);
+    double *w = malloc(sizeof(double)*2*len);
+    assert(tmp != NULL && w != NULL);
+    for (k = 0; k < len; k++)
+    {
+        w[2*k+0] = cos(2*M_PI*(double)k/(double)len);
+        w[2*k+1] = -sin(2*M_PI*(double)k/(double)len);
+    }
+    for (k = 0; k < len; k++)
+    {
+        double x = 0, y = 0;
+        q = k % m;
+        for (r = 0; r < p; r++)
+        {
+            int e = (int)(((long long)r*k) % len);
+            x += out[2*(r*m+q)] * w[2*e] - out[2*(r*m+q)+1] * w[2*e+1];
+            y += out[2*(r*m+q)] * w[2*e+1] + out[2*(r*m+q)+1] * w[2*e];
+        }
+        tmp[2*k+0] = x;
+        tmp[2*k+1] = y;
+    }
+    memcpy(out, tmp, sizeof(double)*2*len);
+    free(tmp);
+    free(w);
+}
+
+/** reference FFT of @p len points (any length) computed in double */
+void
+fft_mixed_reference(cplx_float_t *in, int len)
+{
+    double *x = malloc(sizeof(double)*2*len);
+    double *X = malloc(sizeof(double)*2*len);
+    assert(x != NULL && X != NULL);
+    for (int i = 0; i < len; i++)
+    {
+        x[2*i+0] = in[i].x;
+        x[2*i+1] = in[i].y;
+    }
+    fft_mixed_reference_(x, 1, len, X);
+    for (int i = 0; i < len; i++)
+    {
+        in[i].x = (float)X[2*i+0];
+        in[i].y = (float)X[2*i+1];
+    }
+    free(x);
+    free(X);
+}
+
+/** reference forward FFT of the @p len points of @p in: the float radix-2
+ *  one when possible, the double one otherwise
+ *  @return the tolerance relative to the peak magnitude to check against it
+ */
+static float
+fft_reference(cplx_float_t *in, int len)
+{
+    if ((len & (len-1)) == 0)
+    {
+        fft_radix_2_float_reference(in, len);
+        return 0.f;
+    }
+    fft_mixed_reference(in, len);
+    /* follows the float precision of the clusters */
+    return TEST_REL_THRESHOLD;
+}
+
+#if FFT_MODE == FFT_MODE_CONV
+/** number of taps of the impulse response of the convolution filter */
+#define NB_FILTER_TAPS (16)
+
+/** circular convolution of the @p len points of @p in with the @p taps
+ *  first points of @p h, computed directly (correlation with FFT_CORRELATE
+ *  builds)
+ */
+static void
+conv_reference(const cplx_float_t *in, const float *h, int taps, int len, cplx_float_t *out)
+{
+    for (int n = 0; n < len; n++)
+    {
+        double x = 0, y = 0;
+        for (int k = 0; k < taps; k++)
+        {
+#ifdef FFT_CORRELATE
+            int m = (n + k) % len;
+#else
+            int m = (n - k + len) % len;
+#endif
+            x += h[k] * in[m].x;
+            y += h[k] * in[m].y;
+        }
+        out[n].x = (float)x;
+        out[n].y = (float)y;
+    }
+}
+#endif
+
+#if FFT_WINDOW != FFT_WINDOW_NONE
+/** multiply the @p len points of @p m by the window (FFT_WINDOW) */
+static void
+window_reference(cplx_float_t *m, int len)
+{
+    for (int n = 0; n < len; n++)
+    {
+        double a = 2*M_PI*n/len;
+        double w = FFT_WINDOW_A0 - FFT_WINDOW_A1*cos(a) + FFT_WINDOW_A2*cos(2*a);
+        m[n].x = (float)(m[n].x*w);
+        m[n].y = (float)(m[n].y*w);
+    }
+}
+#endif
+
+#if FFT_OUTPUT != FFT_OUTPUT_COMPLEX
+/** Check the output stage (FFT_OUTPUT) of the clusters: the floats of
+ *  @p matrix_out are converted back to magnitudes and compared to the
+ *  magnitudes of the @p len points of @p matrix_check (bins [@p first,
+ *  @p first + @p points) only)
+ *  @param[inout] mag_diff value of the maximal absolute diff between
+ *                         magnitudes (MUST be init with 0.f)
+ *  @param rel_threshold tolerance relative to the peak magnitude of
+ *                       matrix_check, added to TEST_THRESHOLD
+ */
+int check_result_output(const float* matrix_out, const cplx_float_t* matrix_check, int len,
+                        int first, int points, float* mag_diff, float rel_threshold)
+{
+    int diff = 0;
+    float peak = 0.f;
+    for(int ii=0;ii<len;ii++)
+    {
+        peak = fmaxf(peak, hypotf(matrix_check[ii].x, matrix_check[ii].y));
+    }
+#if FFT_OUTPUT == FFT_OUTPUT_DB
+    rel_threshold += TEST_DB_REL_THRESHOLD;
+#endif
+    float threshold = TEST_THRESHOLD + rel_threshold*peak;
+
+    for(int ii=first;ii<first+points;ii++)
+    {
+#if FFT_OUTPUT == FFT_OUTPUT_POWER
+        float mag = sqrtf(fmaxf(matrix_out[ii], 0.f));
+#elif FFT_OUTPUT == FFT_OUTPUT_MAGNITUDE
+        float mag = matrix_out[ii];
+#else
+        float mag = sqrtf(powf(10.f, matrix_out[ii]/10.f));
+#endif
+        float abs_diff = fabs(mag - hypotf(matrix_check[ii].x, matrix_check[ii].y));
+        if( abs_diff > threshold || isnan(mag) )
+        {
+            diff++;
+        }
+        if(abs_diff > *mag_diff)
+            *mag_diff = abs_diff;
+    }
+    return diff;
+}
+#endif
+
 /** Check if absolute difference between matrix_out coefficients and matrix_check
  *  ones exceed TEST_THRESHOLD
+ *  @param len number of points of the matrices
+ *  @param first first bin written by the clusters (output band of a pruned FFT)
+ *  @param points number of bins written by the clusters
  *  @param[inout] real_diff value of the maximal absolute diff between
  *                          real coeffs (MUST be init with 0.f)
  *  @param[inout] im_diff value of the maximal absolute diff between
  *                          imaginary coeffs (MUST be init with 0.f)
+ *  @param rel_threshold tolerance relative to the peak magnitude of
+ *                       matrix_check, added to TEST_THRESHOLD
+ *  Only the bins of the output band are checked.
  */
-int check_result_matrix(cplx_float_t* matrix_out, cplx_float_t* matrix_check,
-                        float* real_diff, float* im_diff)
+int check_result_matrix(cplx_float_t* matrix_out, cplx_float_t* matrix_check, int len,
+                        int first, int points, float* real_diff, float* im_diff, float rel_threshold)
 {
     // number of differences
     int diff = 0;
+    float peak = 0.f;
+    for(int ii=0;ii<len;ii++)
+    {
+        peak = fmaxf(peak, fmaxf(fabs(matrix_check[ii].x), fabs(matrix_check[ii].y)));
+    }
+    float threshold = TEST_THRESHOLD + rel_threshold*peak;
 
-    for(int ii=0;ii<HEIGHT;ii++)
+    for(int ii=first;ii<first+points;ii++)
     {
-        for(int jj=0;jj<WIDTH;jj++)
+        float abs_diff = fabs(matrix_out[ii].x-matrix_check[ii].x);
+        if( abs_diff > threshold || isnan(matrix_out[ii].x) )
         {
-            float abs_diff = fabs(matrix_out[ii*HEIGHT + jj].x-matrix_check[ii*HEIGHT + jj].x);
-            if( abs_diff > TEST_THRESHOLD || isnan(matrix_out[ii*HEIGHT + jj].x) )
-            {
-                diff++;
-            }
-            if(abs_diff > *real_diff)
-                *real_diff = diff;
+            diff++;
         }
+        if(abs_diff > *real_diff)
+            *real_diff = abs_diff;
     }
-    for(int ii=0;ii<HEIGHT;ii++)
+    for(int ii=first;ii<first+points;ii++)
     {
-        for(int jj=0;jj<WIDTH;jj++)
+        float abs_diff =  fabs(matrix_out[ii].y -matrix_check[ii].y);
+        if( abs_diff > threshold || isnan(matrix_out[ii].y) )
         {
-            float abs_diff =  fabs(matrix_out[ii*HEIGHT + jj].y -matrix_check[ii*HEIGHT + jj].y);
-            if( abs_diff > TEST_THRESHOLD || isnan(matrix_out[ii*HEIGHT + jj].y) )
-            {
-                diff++;
-            }
-            if(abs_diff > *im_diff)
-                *im_diff = diff;
+            diff++;
         }
+        if(abs_diff > *im_diff)
+            *im_diff = abs_diff;
     }
 
     return diff;
 }
 
 
-int main() {
-    mppadesc_t pcie_fd = 0;
-    if (__k1_spawn_type() == __MPPA_PCI_SPAWN) {
-        pcie_fd = pcie_open(0);
-        pcie_queue_init(pcie_fd);
-        pcie_register_console(pcie_fd, stdin, stdout);
+/** a group of clusters running its own stream of FFTs (FFT_GROUPS) */
+typedef struct {
+    int nb_cluster;     /* clusters of the group, from cluster first */
+    int first;
+    int width;          /* matrix of the group */
+    int height;
+    int input_points;   /* pruned FFT (single group only) */
+    int output_first;
+    int output_points;
+    cplx_float_t *matrix;
+    cplx_float_t *matrix_out;
+    cplx_float_t *matrix_check;
+    /* input read from the test-vector file, and its reference of this build
+     * loaded in matrix_check */
+    int loaded;
+    int cached;
+    float rel_threshold;
+#if FFT_MODE == FFT_MODE_CONV
+    cplx_float_t *filter;
+    float taps[NB_FILTER_TAPS];
+    int nb_taps;
+#endif
+    /** plan shared with the clusters of the group (PLAN_SEGMENT_ID) */
+    fft_plan_t plan __attribute__((aligned(64)));
+    mppa_async_segment_t matrix_segment;
+    mppa_async_segment_t matrix_segment_out;
+    mppa_async_segment_t plan_segment;
+#if FFT_MODE == FFT_MODE_CONV
+    mppa_async_segment_t filter_segment;
+#endif
+#ifdef FFT_SERVICE
+    /** commands of the resident service (MAILBOX_SEGMENT_ID) */
+    fft_mailbox_t mailbox __attribute__((aligned(64)));
+    mppa_async_segment_t mailbox_segment;
+#endif
+} fft_group_t;
+
+static fft_group_t groups[FFT_MAX_GROUP];
+static int nb_group = 0;
+
+/** fill groups[] from FFT_GROUPS ("clusters:WIDTHxHEIGHT ...", the groups
+ *  take the clusters in order), or a single group of the NB_CLUSTER
+ *  clusters on the WIDTH x HEIGHT matrix of the build
+ *  @return the number of clusters used, -1 if the layout is invalid
+ */
+static int
+groups_parse(void)
+{
+    int nb_used = 0;
+#ifdef FFT_GROUPS
+    const char *layout = FFT_GROUPS;
+    int nc, w, h, n;
+    while (sscanf(layout, " %d:%dx%d%n", &nc, &w, &h, &n) == 3)
+    {
+        if (nb_group == FFT_MAX_GROUP || nc < 1 || nc > 16 || w < nc || h < nc)
+        {
+            printf("# [IODDR0] invalid group %d:%dx%d\n", nc, w, h);
+            return -1;
+        }
+        fft_group_t *g = &groups[nb_group++];
+        g->nb_cluster = nc;
+        g->first = nb_used;
+        g->width = w;
+        g->height = h;
+        g->input_points = w*h;
+        g->output_first = 0;
+        g->output_points = w*h;
+        nb_used += nc;
+        layout += n;
     }
-    mppa_rpc_server_init(1, 0, NB_CLUSTER);
-    mppa_async_server_init();
-    mppa_remote_server_init(pcie_fd, NB_CLUSTER);
+    if (nb_group == 0 || sscanf(layout, " %*c") != EOF)
+    {
+        printf("# [IODDR0] invalid group layout \"%s\"\n", FFT_GROUPS);
+        return -1;
+    }
+#else
+    fft_group_t *g = &groups[nb_group++];
+    g->nb_cluster = NB_CLUSTER;
+    g->first = 0;
+    g->width = WIDTH;
+    g->height = HEIGHT;
+    g->input_points = FFT_INPUT_POINTS;
+    g->output_first = FFT_OUTPUT_FIRST;
+    g->output_points = FFT_OUTPUT_POINTS;
+    nb_used = NB_CLUSTER;
+#endif
+    if (nb_used > NB_CLUSTER)
+    {
+        printf("# [IODDR0] the groups need %d clusters, %d available\n", nb_used, NB_CLUSTER);
+        return -1;
+    }
+    return nb_used;
+}
 
-    for(unsigned i=0;i<NB_CLUSTER;i++){
-        if (mppa_power_base_spawn(i, "cluster_bin", NULL, NULL, MPPA_POWER_SHUFFLING_ENABLED) == -1)
-            printf("# [IODDR0] Fail to Spawn cluster %d\n", i);
+/** write in @p sig the problem signature of group @p g keying the wisdom
+ *  entries: every build time parameter the best plan depends on
+ */
+static void
+wisdom_signature(const fft_group_t *g, char *sig, size_t len)
+{
+    static const char *mode[] = {"", "-inverse", "-conv"};
+    static const char *window[] = {"", "-hann", "-hamming", "-blackman"};
+    static const char *output[] = {"", "-power", "-magnitude", "-db"};
+    static const char *order[] = {"", "-transposed"};
+#ifdef FFT_INPLACE_TRANSPOSE
+    /* the in-place transpose restricts the candidates (DIT, column DMA) */
+    const char *inplace = "-inplace";
+#else
+    const char *inplace = "";
+#endif
+    const int points = g->width*g->height;
+    int n = snprintf(sig, len, "fft6step-cf32-%dx%d-c%d-p%d-n%d%s%s%s%s%s%s",
+                     g->width, g->height, g->nb_cluster, N_CORES, N, inplace, mode[FFT_MODE],
+                     window[FFT_WINDOW], output[FFT_OUTPUT], order[FFT_ORDER], FFT_PIPELINE ? "-pipeline" : "");
+    if ((g->input_points < points || g->output_first > 0 || g->output_points < points) &&
+        n > 0 && (size_t)n < len)
+        snprintf(sig + n, len - n, "-in%d-out%d+%d", g->input_points, g->output_first, g->output_points);
+}
+
+/** look for the signature of group @p g in FFT_WISDOM_FILE, the last
+ *  matching entry wins
+ *  @return 1 if the plan of @p g was loaded, 0 otherwise
+ */
+static int
+wisdom_load(fft_group_t *g)
+{
+    char sig[128], entry_sig[128], line[256];
+    fft_plan_t entry;
+    int found = 0;
+    FILE *f = fopen(FFT_WISDOM_FILE, "r");
+    if (f == NULL)
+        return 0;
+    wisdom_signature(g, sig, sizeof(sig));
+    while (fgets(line, sizeof(line), f))
+    {
+        memset(&entry, 0, sizeof(entry));
+        if (sscanf(line, "%127s kernel=%d radix=%d pe_per_row=%d dma=%d time_ms=%f", entry_sig,
+                   &entry.kernel, &entry.radix, &entry.pe_per_row, &entry.dma, &entry.time_ms) == 6 &&
+            strcmp(sig, entry_sig) == 0)
+        {
+            entry.valid = 1;
+            g->plan = entry;
+            found = 1;
+        }
     }
+    fclose(f);
+    return found;
+}
 
-    utask_t t;
-    utask_create(&t, NULL, (void*)mppa_rpc_server_start, NULL);
+/** append the plan of group @p g to FFT_WISDOM_FILE
+ *  @return 0 on success, -1 otherwise
+ */
+static int
+wisdom_save(const fft_group_t *g)
+{
+    char sig[128];
+    FILE *f = fopen(FFT_WISDOM_FILE, "a");
+    if (f == NULL)
+        return -1;
+    wisdom_signature(g, sig, sizeof(sig));
+    fprintf(f, "%s kernel=%d radix=%d pe_per_row=%d dma=%d time_ms=%f\n", sig,
+            g->plan.kernel, g->plan.radix, g->plan.pe_per_row, g->plan.dma, g->plan.time_ms);
+    fclose(f);
+    return 0;
+}
+
+#ifdef FFT_VECTORS_FILE
+/** test-vector file of group @p g: FFT_VECTORS_FILE-<WIDTH>x<HEIGHT>.fftv,
+ *  shared by the groups of the same size
+ */
+static void
+vectors_path(const fft_group_t *g, char *path, size_t len)
+{
+    snprintf(path, len, "%s-%dx%d.fftv", FFT_VECTORS_FILE, g->width, g->height);
+}
+
+/** key of the reference of group @p g: hash of its input (matrix_check)
+ *  and of every parameter the reference depends on
+ */
+static uint64_t
+vectors_key(const fft_group_t *g)
+{
+#ifdef FFT_CORRELATE
+    const int correlate = 1;
+#else
+    const int correlate = 0;
+#endif
+#if FFT_MODE == FFT_MODE_CONV
+    return fft_vectors_key(g->matrix_check, g->width, g->height, FFT_MODE, FFT_WINDOW, correlate,
+                           g->taps, g->nb_taps);
+#else
+    return fft_vectors_key(g->matrix_check, g->width, g->height, FFT_MODE, FFT_WINDOW, correlate, NULL, 0);
+#endif
+}
+
+/** read the input of group @p g from its test-vector file, straight into
+ *  the matrix of its DDR segment, and the reference into matrix_check when
+ *  the file holds one with the key of this build
+ *  @return 1 if the input was loaded, 0 if there is no file of this size
+ */
+static int
+vectors_load(fft_group_t *g)
+{
+    const int points = g->width*g->height;
+    char path[256];
+    fft_vectors_header_t header;
+    fft_vectors_record_t record;
+    vectors_path(g, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return 0;
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != FFT_VECTORS_MAGIC ||
+        header.version != FFT_VECTORS_VERSION || header.width != g->width || header.height != g->height ||
+        fread(g->matrix, sizeof(cplx_float_t), points, f) != (size_t)points)
+    {
+        printf("# [IODDR0] %s is not a %dx%d test-vector file, ignored\n", path, g->width, g->height);
+        fclose(f);
+        return 0;
+    }
+    /* zero padding after input_points (pruned FFT) */
+    for(int i=g->input_points;i<points;i++)
+    {
+        g->matrix[i].x = 0.f;
+        g->matrix[i].y = 0.f;
+    }
+    memcpy(g->matrix_check, g->matrix, sizeof(cplx_float_t)*points);
+    g->loaded = 1;
+    uint64_t key = vectors_key(g);
+    for(int i=0;i<header.nb_reference && i<FFT_VECTORS_MAX_REFERENCE;i++)
+    {
+        if (fseek(f, fft_vectors_record_offset(points, i), SEEK_SET) != 0 ||
+            fread(&record, sizeof(record), 1, f) != 1)
+            break;
+        if (record.key != key)
+            continue;
+        if (fread(g->matrix_check, sizeof(cplx_float_t), points, f) == (size_t)points)
+        {
+            g->cached = 1;
+            g->rel_threshold = record.rel_threshold;
+        }else
+        {
+            memcpy(g->matrix_check, g->matrix, sizeof(cplx_float_t)*points);
+        }
+        break;
+    }
+    fclose(f);
+    return 1;
+}
+
+/** open the test-vector file of group @p g to add the reference of this
+ *  build: the file its input was loaded from, or a new file holding its
+ *  input (matrix_check, before the reference is computed in place). The
+ *  reference is added by vectors_finish()
+ *  @return the open file, NULL on error
+ */
+static FILE*
+vectors_open(const fft_group_t *g)
+{
+    const int points = g->width*g->height;
+    char path[256];
+    fft_vectors_header_t header;
+    vectors_path(g, path, sizeof(path));
+    FILE *f = fopen(path, g->loaded ? "r+b" : "w+b");
+    if (f == NULL)
+    {
+        printf("# [IODDR0] failed to write test-vector file %s\n", path);
+        return NULL;
+    }
+    if (g->loaded)
+        return f;
+    memset(&header, 0, sizeof(header));
+    header.magic = FFT_VECTORS_MAGIC;
+    header.version = FFT_VECTORS_VERSION;
+    header.width = g->width;
+    header.height = g->height;
+    if (fwrite(&header, sizeof(header), 1, f) != 1 ||
+        fwrite(g->matrix_check, sizeof(cplx_float_t), points, f) != (size_t)points)
+    {
+        printf("# [IODDR0] failed to write test-vector file %s\n", path);
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+/** store the reference of group @p g (matrix_check) in the file @p f of
+ *  vectors_open(): in a new record, or in place of the oldest one when the
+ *  file holds FFT_VECTORS_MAX_REFERENCE records
+ */
+static void
+vectors_finish(const fft_group_t *g, FILE *f, uint64_t key, float rel_threshold)
+{
+    const int points = g->width*g->height;
+    fft_vectors_header_t header;
+    fft_vectors_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.key = key;
+    record.rel_threshold = rel_threshold;
+    if (fseek(f, 0, SEEK_SET) != 0 || fread(&header, sizeof(header), 1, f) != 1)
+    {
+        printf("# [IODDR0] failed to read the header of the test-vector file\n");
+        fclose(f);
+        return;
+    }
+    int slot;
+    if (header.nb_reference < FFT_VECTORS_MAX_REFERENCE)
+    {
+        slot = header.nb_reference++;
+    }else
+    {
+        slot = header.next_reference;
+        header.next_reference = (slot + 1) % FFT_VECTORS_MAX_REFERENCE;
+    }
+    /* the record is complete before the header counts it */
+    if (fseek(f, fft_vectors_record_offset(points, slot), SEEK_SET) != 0 ||
+        fwrite(&record, sizeof(record), 1, f) != 1 ||
+        fwrite(g->matrix_check, sizeof(cplx_float_t), points, f) != (size_t)points ||
+        fflush(f) != 0 || fseek(f, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, f) != 1)
+    {
+        printf("# [IODDR0] failed to write the reference of the test-vector file\n");
+    }
+    fclose(f);
+}
+#endif
+
+/** fill the matrices of group @p g @p id for its size and load its wisdom */
+static void
+group_fill(fft_group_t *g, int id)
+{
+    const int points = g->width*g->height;
+#if FFT_MODE == FFT_MODE_CONV
+    /* filter: spectrum of a short real impulse response, drawn first so
+     * that it does not depend on the origin of the input */
+    memset(g->filter, 0, sizeof(cplx_float_t)*points);
+    g->nb_taps = points < NB_FILTER_TAPS ? points : NB_FILTER_TAPS;
+    for(int i=0;i<g->nb_taps;i++)
+    {
+        g->taps[i] = (float)rand()/RAND_MAX;
+        g->filter[i].x = g->taps[i];
+    }
+    fft_reference(g->filter, points);
+#endif
+
+    g->loaded = 0;
+    g->cached = 0;
+    g->rel_threshold = 0.f;
+#ifdef FFT_VECTORS_FILE
+    if (!vectors_load(g))
+#endif
+    {
+        float v = 0;
+        for(int i=0;i<points;i++)
+        {
+            /* zero padding after input_points (pruned FFT) */
+            v = i < g->input_points ? (float)rand()/(RAND_MAX/32) : 0.f;
+            g->matrix[i].x = (float)v;
+            g->matrix[i].y = (float)0.0f;
+            g->matrix_check[i].x = (float)v;
+            g->matrix_check[i].y = (float)0.0f;
+        }
+    }
+    __builtin_k1_wpurge();
+    __builtin_k1_fence();
+
+    /* the plan of the previous size of a resident service does not apply */
+    memset(&g->plan, 0, sizeof(g->plan));
+    if (wisdom_load(g))
+    {
+        printf("# [IODDR0] group %d wisdom %s: kernel %d radix %d pe_per_row %d dma %d (%.4f ms)\n", id, FFT_WISDOM_FILE,
+               g->plan.kernel, g->plan.radix, g->plan.pe_per_row, g->plan.dma, g->plan.time_ms);
+    }
+    __builtin_k1_wpurge();
+    __builtin_k1_fence();
+}
 
-    int matrix_size = sizeof(cplx_float_t)*WIDTH*HEIGHT;
+/** allocate the matrices of group @p g @p id for @p capacity points, fill
+ *  them and create its segments
+ *  @param extra bytes of the pool segment past the matrices, left to the
+ *               buffers of the host queue (FFT_SERVICE)
+ *  @return 0 on success, -1 otherwise
+ */
+static int
+group_setup(fft_group_t *g, int id, int capacity, size_t extra)
+{
+    int matrix_size = sizeof(cplx_float_t)*capacity;
 
-    cplx_float_t *matrix = NULL;
-    cplx_float_t *matrix_out = NULL;
-    cplx_float_t *matrix_check = NULL;
-    posix_memalign((void*)&matrix, 1<<13, matrix_size);
-    posix_memalign((void*)&matrix_out, 1<<13, matrix_size);
-    posix_memalign((void*)&matrix_check, 1<<13, matrix_size);
+#ifdef FFT_SERVICE
+    /* one pool segment holds the input and output buffers of the requests */
+    posix_memalign((void*)&g->matrix, 1<<13, 2*matrix_size + extra);
+    g->matrix_out = g->matrix ? g->matrix + capacity : NULL;
+#else
+    posix_memalign((void*)&g->matrix, 1<<13, matrix_size);
+    posix_memalign((void*)&g->matrix_out, 1<<13, matrix_size);
+#endif
+    posix_memalign((void*)&g->matrix_check, 1<<13, matrix_size);
 
-    if (!matrix) {
+    if (!g->matrix) {
         printf("ERROR: failed to allocate matrix\n");
         return -1;
     }
-    if (!matrix_out) {
+    if (!g->matrix_out) {
         printf("ERROR: failed to allocate matrix_out\n");
         return -1;
     }
-    if (!matrix_check) {
+    if (!g->matrix_check) {
         printf("ERROR: failed to allocate matrix_check\n");
         return - 1;
     }
 
+#if FFT_MODE == FFT_MODE_CONV
+    posix_memalign((void*)&g->filter, 1<<13, matrix_size);
+    if (!g->filter) {
+        printf("ERROR: failed to allocate filter\n");
+        return -1;
+    }
+#endif
+
+    group_fill(g, id);
+
+#ifdef FFT_SERVICE
+    mppa_async_segment_create(&g->matrix_segment, GROUP_SEGMENT_ID(MATRIX_SEGMENT_ID, id), g->matrix,
+                              2*matrix_size + extra, 0, 0, NULL);
+#else
+    mppa_async_segment_create(&g->matrix_segment, GROUP_SEGMENT_ID(MATRIX_SEGMENT_ID, id), g->matrix,
+                              matrix_size, 0, 0, NULL);
+    mppa_async_segment_create(&g->matrix_segment_out, GROUP_SEGMENT_ID(MATRIX_SEGMENT_ID+1, id),
+                              g->matrix_out, matrix_size, 0, 0, NULL);
+#endif
+    mppa_async_segment_create(&g->plan_segment, GROUP_SEGMENT_ID(PLAN_SEGMENT_ID, id),
+                              &g->plan, sizeof(g->plan), 0, 0, NULL);
+#if FFT_MODE == FFT_MODE_CONV
+    mppa_async_segment_create(&g->filter_segment, GROUP_SEGMENT_ID(FILTER_SEGMENT_ID, id),
+                              g->filter, matrix_size, 0, 0, NULL);
+#endif
+#ifdef FFT_SERVICE
+    mppa_async_segment_create(&g->mailbox_segment, GROUP_SEGMENT_ID(MAILBOX_SEGMENT_ID, id),
+                              &g->mailbox, sizeof(g->mailbox), 0, 0, NULL);
+#endif
+    return 0;
+}
+
+#if FFT_ORDER == FFT_ORDER_TRANSPOSED
+/** put the output of group @p g, in transposed order, back in natural order */
+static void
+output_natural_order(fft_group_t *g)
+{
+    const int points = g->width*g->height;
+    char *out = (char*)g->matrix_out;
+    char *tmp = malloc(FFT_OUTPUT_SIZE*points);
+    assert(tmp != NULL);
+    for(int k=0;k<points;k++)
+    {
+        memcpy(tmp + FFT_OUTPUT_SIZE*k, out + FFT_OUTPUT_SIZE*FFT_TRANSPOSED_INDEX(k, g->width, g->height), FFT_OUTPUT_SIZE);
+    }
+    memcpy(out, tmp, FFT_OUTPUT_SIZE*points);
+    free(tmp);
+}
+#endif
+
+/** compare the result of group @p g @p id with the reference and report it
+ *  @return the number of differences
+ */
+static int
+group_check(fft_group_t *g, int id)
+{
+    const int points = g->width*g->height;
+    cplx_float_t *matrix_check = g->matrix_check;
+
+    float rel_threshold = g->rel_threshold;
+    uint64_t start = __k1_read_dsu_timestamp();
+    if (!g->cached)
     {
-        float v = 0;
-        for(int i=0;i<WIDTH*HEIGHT;i++)
+#ifdef FFT_VECTORS_FILE
+        /* cache the reference with the input it is computed from */
+        uint64_t key = vectors_key(g);
+        FILE *vectors = vectors_open(g);
+#endif
+#if FFT_WINDOW != FFT_WINDOW_NONE
+        /* the clusters are done with the input, window it for the reference */
+        window_reference(g->matrix, points);
+        window_reference(matrix_check, points);
+#endif
+#if FFT_MODE == FFT_MODE_INVERSE
+        /* inverse FFT: conj(FFT(conj(x)))/(WIDTH*HEIGHT) */
+        for(int i=0;i<points;i++)
+            matrix_check[i].y = -matrix_check[i].y;
+        rel_threshold = fft_reference(matrix_check, points);
+        for(int i=0;i<points;i++)
+        {
+            matrix_check[i].x = matrix_check[i].x/points;
+            matrix_check[i].y = -matrix_check[i].y/points;
+        }
+#elif FFT_MODE == FFT_MODE_CONV
+        conv_reference(g->matrix, g->taps, g->nb_taps, points, matrix_check);
+#else
+        rel_threshold = fft_reference(matrix_check, points);
+#endif
+#ifdef FFT_VECTORS_FILE
+        if (vectors != NULL)
+            vectors_finish(g, vectors, key, rel_threshold);
+#endif
+    }
+    printf("# [IODDR0] group %d reference %s in %.2f ms\n", id, g->cached ? "loaded" : "computed",
+           (float)(__k1_read_dsu_timestamp() - start)/((float)__bsp_frequency/1000.0f));
+
+#if FFT_ORDER == FFT_ORDER_TRANSPOSED
+    output_natural_order(g);
+#endif
+
+    float im_diff = 0.f;
+    float real_diff = 0.f;
+#if FFT_OUTPUT != FFT_OUTPUT_COMPLEX
+    /* one float per point: the power, magnitude or dB of the spectrum */
+    int diff = check_result_output((float*)g->matrix_out, matrix_check, points,
+                                   g->output_first, g->output_points, &real_diff, rel_threshold);
+#else
+    int diff = check_result_matrix(g->matrix_out, matrix_check, points,
+                                   g->output_first, g->output_points, &real_diff, &im_diff, rel_threshold);
+#endif
+
+    if (g->plan.searched)
+    {
+        printf("# [IODDR0] group %d autotune: kernel %d radix %d pe_per_row %d dma %d (%.4f ms)\n", id,
+               g->plan.kernel, g->plan.radix, g->plan.pe_per_row, g->plan.dma, g->plan.time_ms);
+        /* a plan is only worth keeping if its run is correct */
+        if (diff)
+            printf("# [IODDR0] group %d plan not saved to %s\n", id, FFT_WISDOM_FILE);
+        else if (wisdom_save(g) != 0)
+            printf("# [IODDR0] failed to write wisdom file %s\n", FFT_WISDOM_FILE);
+    }
+
+    if(diff)
+    {
+        printf("# [IODDR0] group %d real_diff %e im_diff %e diff %d FAILED\n", id, real_diff, im_diff, diff);
+    }
+    return diff;
+}
+
+#ifdef FFT_SERVICE
+/* sizes served by the resident service: FFT_SERVICE_SIZES ("WIDTHxHEIGHT
+ * ...", one binary sized for the largest width and height) or the size of
+ * the build */
+static int service_width[FFT_MAX_GROUP];
+static int service_height[FFT_MAX_GROUP];
+static int nb_service_size = 0;
+
+/** fill service_width/height[]
+ *  @return the largest number of points, -1 if the list is invalid
+ */
+static int
+service_parse(void)
+{
+    int capacity = 0;
+#ifdef FFT_SERVICE_SIZES
+    const char *sizes = FFT_SERVICE_SIZES;
+    int w, h, n;
+    while (sscanf(sizes, " %dx%d%n", &w, &h, &n) == 2)
+    {
+#ifdef FFT_INPLACE_TRANSPOSE
+        /* square matrix and equal bands */
+        const int invalid = w != h || w % NB_CLUSTER != 0;
+#else
+        const int invalid = 0;
+#endif
+        if (nb_service_size == FFT_MAX_GROUP || w < NB_CLUSTER || h < NB_CLUSTER || invalid)
         {
-            v = (float)rand()/(RAND_MAX/32);
-            matrix[i].x = (float)v;
-            matrix[i].y = (float)0.0f;
-            matrix_check[i].x = (float)v;
-            matrix_check[i].y = (float)0.0f;
+            printf("# [IODDR0] invalid service size %dx%d\n", w, h);
+            return -1;
         }
+        service_width[nb_service_size] = w;
+        service_height[nb_service_size++] = h;
+        sizes += n;
+    }
+    if (nb_service_size == 0 || sscanf(sizes, " %*c") != EOF)
+    {
+        printf("# [IODDR0] invalid service sizes \"%s\"\n", FFT_SERVICE_SIZES);
+        return -1;
+    }
+#else
+    service_width[nb_service_size] = WIDTH;
+    service_height[nb_service_size++] = HEIGHT;
+#endif
+    for (int s=0;s<nb_service_size;s++)
+    {
+        if (service_width[s]*service_height[s] > capacity)
+            capacity = service_width[s]*service_height[s];
     }
+    return capacity;
+}
+
+/** spawn the service binary on the clusters of group @p g, serving first
+ *  its current size, with the input and output buffers of @p capacity
+ *  points at the start of its pool segment
+ *  @return the timestamp of the spawn
+ */
+static uint64_t
+service_spawn(fft_group_t *g, int capacity)
+{
+    memset(&g->mailbox, 0, sizeof(g->mailbox));
+    g->mailbox.in_offset = 0;
+    g->mailbox.out_offset = sizeof(cplx_float_t)*capacity;
+    g->mailbox.width = g->width;
+    g->mailbox.height = g->height;
     __builtin_k1_wpurge();
     __builtin_k1_fence();
+    uint64_t start = __k1_read_dsu_timestamp();
+    for(int i=g->first;i<g->first+g->nb_cluster;i++){
+        if (mppa_power_base_spawn(i, "cluster_bin", NULL, NULL, MPPA_POWER_SHUFFLING_ENABLED) == -1)
+            printf("# [IODDR0] Fail to Spawn cluster %d\n", i);
+    }
+    return start;
+}
 
-    mppa_async_segment_t matrix_segment;
-    mppa_async_segment_t matrix_segment_out;
-    mppa_async_segment_create(&matrix_segment, MATRIX_SEGMENT_ID, matrix,
-                              matrix_size, 0, 0, NULL);
-    mppa_async_segment_create(&matrix_segment_out, MATRIX_SEGMENT_ID+1,
-                              matrix_out, matrix_size, 0, 0, NULL);
+/** wait until the clusters of group @p g are ready for commands
+ *  @return the time since their spawn at @p start, in ms
+ */
+static float
+service_ready(fft_group_t *g, uint64_t start)
+{
+    mppa_async_evalcond(&g->mailbox.ready, g->nb_cluster, MPPA_ASYNC_COND_GE, NULL);
+    return (float)(__k1_read_dsu_timestamp() - start)/((float)__bsp_frequency/1000.0f);
+}
 
+/** post the command @p cmd (FFT_CMD_*) for the current size of group @p g,
+ *  ring the doorbell of its clusters and wait until they are through with
+ *  it
+ *  @return the timestamp of its completion
+ */
+static uint64_t
+service_command(fft_group_t *g, int cmd)
+{
+    g->mailbox.cmd = cmd;
+    g->mailbox.width = g->width;
+    g->mailbox.height = g->height;
+    g->mailbox.seq++;
+    __builtin_k1_wpurge();
+    __builtin_k1_fence();
+    const off64_t doorbell = __builtin_k1_ldu(&g->mailbox.doorbell);
+    for(int i=g->first;i<g->first+g->nb_cluster;i++)
+        mppa_async_postadd(mppa_async_default_segment(i), doorbell, 1);
+    mppa_async_evalcond(&g->mailbox.done, g->mailbox.seq*g->nb_cluster, MPPA_ASYNC_COND_GE, NULL);
+    return __k1_read_dsu_timestamp();
+}
 
+/** wait for the exit of the clusters of group @p g
+ *  @return the sum of their exit status
+ */
+static int
+service_waitpid(const fft_group_t *g)
+{
     int status = 0;
-    for(unsigned i=0;i<NB_CLUSTER;i++){
+    for(int i=g->first;i<g->first+g->nb_cluster;i++){
         int ret;
         if (mppa_power_base_waitpid(i, &ret, 0) < 0) {
-            printf("# [IODDR0] Waitpid failed on cluster %d\n", i);
+            printf("# [IODDR0] Waitpid failed on cluster %d\n", i);
         }
         status += ret;
     }
-    if(status != 0)
+    return status;
+}
+
+static int
+latency_compare(const void *a, const void *b)
+{
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+/** latency of the FFT_CMD_EXECUTE requests of group @p g under bursty
+ *  arrivals: for each load of FFT_SERVICE_LOADS, FFT_SERVICE_REQUESTS
+ *  requests arrive in bursts of FFT_SERVICE_BURST spaced to give that
+ *  fraction of the throughput of back-to-back requests. One request is in
+ *  flight at a time, the latency of a request runs from its arrival to its
+ *  completion and includes its wait behind the earlier ones.
+ *  @param startup_ms time from the spawn to the clusters being ready, paid
+ *                    by each request without the resident service
+ */
+static void
+service_latency(fft_group_t *g, float startup_ms)
+{
+    const float freq = (float)__bsp_frequency/1000.0f;
+    const float loads[] = FFT_SERVICE_LOADS;
+    float latency[FFT_SERVICE_REQUESTS];
+
+    uint64_t start = __k1_read_dsu_timestamp();
+    for(int r=0;r<FFT_SERVICE_WARMUP;r++)
+        service_command(g, FFT_CMD_EXECUTE);
+    float service_ms = (float)(__k1_read_dsu_timestamp() - start)/freq/FFT_SERVICE_WARMUP;
+
+    for(int l=0;l<(int)(sizeof(loads)/sizeof(loads[0]));l++)
+    {
+        float period_ms = FFT_SERVICE_BURST*service_ms/loads[l];
+        uint64_t origin = __k1_read_dsu_timestamp();
+        float sum = 0.f;
+        for(int r=0;r<FFT_SERVICE_REQUESTS;r++)
+        {
+            uint64_t arrival = origin + (uint64_t)((r/FFT_SERVICE_BURST)*period_ms*freq);
+            while (__k1_read_dsu_timestamp() < arrival)
+                ;
+            latency[r] = (float)(service_command(g, FFT_CMD_EXECUTE) - arrival)/freq;
+            sum += latency[r];
+        }
+        qsort(latency, FFT_SERVICE_REQUESTS, sizeof(latency[0]), latency_compare);
+        printf("Service FFT %d x %d %d Cluster(s) Load %.2f Burst %d Requests %d Latency avg %.3f p50 %.3f p99 %.3f max %.3f ms Service %.3f ms Startup %.2f ms\n",
+               g->width, g->height, g->nb_cluster, loads[l], FFT_SERVICE_BURST, FFT_SERVICE_REQUESTS,
+               sum/FFT_SERVICE_REQUESTS, latency[FFT_SERVICE_REQUESTS/2],
+               latency[(99*(FFT_SERVICE_REQUESTS-1))/100], latency[FFT_SERVICE_REQUESTS-1], service_ms, startup_ms);
+    }
+}
+
+/** resident service of group @p g: spawn the clusters once, time bursts
+ *  of FFT_CMD_EXECUTE requests and check the last output for each size,
+ *  move to the next size with FFT_CMD_RESIZE (rebuilt in place, no spawn)
+ *  and stop with FFT_CMD_SHUTDOWN
+ *  @return the number of differences, -1 on error
+ */
+static int
+service_run(fft_group_t *g)
+{
+    int capacity = service_parse();
+    if (capacity < 0)
+        return -1;
+    int diff = 0;
+    float startup_ms = 0.f;
+    for(int s=0;s<nb_service_size;s++)
+    {
+#ifdef FFT_SERVICE_SIZES
+        g->width = service_width[s];
+        g->height = service_height[s];
+        g->input_points = g->output_points = g->width*g->height;
+#endif
+        if (s == 0)
+        {
+            /* the clusters set up while the IO fills the matrices and
+             * creates the segments */
+            uint64_t spawn = service_spawn(g, capacity);
+            if (group_setup(g, 0, capacity, 0) != 0)
+                return -1;
+            startup_ms = service_ready(g, spawn);
+        }else
+        {
+            /* new input and wisdom plan, then the clusters rebuild their
+             * plans and LUTs */
+            group_fill(g, 0);
+            uint64_t start = __k1_read_dsu_timestamp();
+            service_command(g, FFT_CMD_RESIZE);
+            printf("# [IODDR0] service resize to %d x %d in %.2f ms\n", g->width, g->height,
+                   (float)(__k1_read_dsu_timestamp() - start)/((float)__bsp_frequency/1000.0f));
+        }
+        service_latency(g, startup_ms);
+        mOS_dinval();
+        diff += group_check(g, 0);
+    }
+    service_command(g, FFT_CMD_SHUTDOWN);
+    if (service_waitpid(g) != 0)
+        return -1;
+    long long rejected = __builtin_k1_ldu(&g->mailbox.rejected);
+    if (rejected != 0)
+    {
+        printf("# [IODDR0] the service rejected %lld command(s)\n", rejected);
         return -1;
+    }
+    return diff;
+}
+#endif
 
-    printf("# IO%d starts checking. Please wait.\n", __k1_get_cluster_id());
-    mOS_dinval();
-    assert(HEIGHT == WIDTH);
-    fft_radix_2_float_reference(matrix_check, WIDTH*HEIGHT);
+#ifdef FFT_HOST_QUEUE
+/** window of the host queue (fft_queue.h), served by the IO */
+static fft_queue_window_t host_window __attribute__((aligned(64)));
+static mppa_async_segment_t host_window_segment;
 
-    float im_diff = 0.f;
-    float real_diff = 0.f;
-    int diff = check_result_matrix(matrix_out, matrix_check, &real_diff, &im_diff);
+/** run the request @p desc of the host on the clusters of group @p g: a
+ *  new matrix size first rebuilds the service on the scratch matrices of
+ *  @p capacity points, then the request runs on its buffers in the pool
+ *  @return its FFT_QUEUE_STATUS_*
+ */
+static int
+host_queue_execute(fft_group_t *g, const fft_queue_desc_t *desc, int capacity)
+{
+    int width, height;
+    if (!fft_queue_desc_valid(&host_window, desc) ||
+        fft_queue_split(&host_window, desc->size, &width, &height) != 0)
+        return FFT_QUEUE_STATUS_EINVAL;
 
-    char string[30];
-    if(diff)
+    const long long rejected = __builtin_k1_ldu(&g->mailbox.rejected);
+    if (width != g->width || height != g->height)
     {
-        sprintf(string, "FAILED");
-    }else
+        /* an autotune overwrites the scratch matrices, not the buffers of
+         * the host, and its plan is only saved if its run is correct */
+        g->width = width;
+        g->height = height;
+        g->input_points = g->output_points = width*height;
+        group_fill(g, 0);
+        g->mailbox.in_offset = 0;
+        g->mailbox.out_offset = sizeof(cplx_float_t)*capacity;
+        service_command(g, FFT_CMD_RESIZE);
+        mOS_dinval();
+        if (g->plan.searched)
+        {
+            service_command(g, FFT_CMD_EXECUTE);
+            mOS_dinval();
+            group_check(g, 0);
+        }
+    }
+    g->mailbox.in_offset = desc->in_addr;
+    g->mailbox.out_offset = desc->out_addr;
+    service_command(g, FFT_CMD_EXECUTE);
+    return __builtin_k1_ldu(&g->mailbox.rejected) == rejected ? FFT_QUEUE_STATUS_OK : FFT_QUEUE_STATUS_EINVAL;
+}
+
+/** host queue of group @p g: spawn the service, publish the window of the
+ *  rings and of the pool (FFT_QUEUE_SEGMENT_ID), then run the requests the
+ *  host submits until it shuts the queue down. The pool holds the scratch
+ *  matrices of the service followed by the buffers of the host.
+ *  @return 0 on success, -1 on error
+ */
+static int
+host_queue_run(fft_group_t *g)
+{
+    int capacity = service_parse();
+    if (capacity < 0)
+        return -1;
+    const size_t matrix_size = sizeof(cplx_float_t)*capacity;
+    const size_t extra = 2*FFT_HOST_POOL_PAIRS*matrix_size;
+    g->width = service_width[0];
+    g->height = service_height[0];
+    g->input_points = g->output_points = g->width*g->height;
+    uint64_t spawn = service_spawn(g, capacity);
+    if (group_setup(g, 0, capacity, extra) != 0)
+        return -1;
+    float startup_ms = service_ready(g, spawn);
+
+    /* the clusters serve any size up to the largest width and height */
+    memset(&host_window, 0, sizeof(host_window));
+    host_window.pool_segment = GROUP_SEGMENT_ID(MATRIX_SEGMENT_ID, 0);
+    host_window.pool_first = 2*matrix_size;
+    host_window.pool_size = 2*matrix_size + extra;
+    host_window.min_side = g->nb_cluster;
+    for (int s=0;s<nb_service_size;s++)
+    {
+        if (service_width[s] > host_window.max_width)
+            host_window.max_width = service_width[s];
+        if (service_height[s] > host_window.max_height)
+            host_window.max_height = service_height[s];
+    }
+#ifdef FFT_INPLACE_TRANSPOSE
+    host_window.flags = FFT_QUEUE_SQUARE;
+#endif
+    mppa_async_segment_create(&host_window_segment, FFT_QUEUE_SEGMENT_ID, &host_window,
+                              sizeof(host_window), 0, 0, NULL);
+    __builtin_k1_wpurge();
+    __builtin_k1_fence();
+    host_window.ready = 1;
+    __builtin_k1_wpurge();
+    __builtin_k1_fence();
+    printf("# [IODDR0] host queue ready in %.2f ms: pool %lld KB, matrices up to %lld x %lld\n", startup_ms,
+           (host_window.pool_size - host_window.pool_first)/1024, host_window.max_width, host_window.max_height);
+
+    long long rung = 0;
+    uint32_t head = 0, tail = 0;
+    int served = 0, failed = 0;
+    while (1)
     {
-        sprintf(string, "SUCCESS");
+        /* the host rings after each move of sq_tail and to shut down */
+        mppa_async_evalcond(&host_window.doorbell, rung + 1, MPPA_ASYNC_COND_GE, NULL);
+        rung = __builtin_k1_ldu(&host_window.doorbell);
+        mOS_dinval();
+        while (head != host_window.queue.sq_tail)
+        {
+            fft_queue_desc_t desc = host_window.queue.sq[head % FFT_QUEUE_DEPTH];
+            host_window.queue.sq_head = ++head;
+            desc.status = host_queue_execute(g, &desc, capacity);
+            served++;
+            failed += desc.status != FFT_QUEUE_STATUS_OK;
+            /* the completion, then the tail that publishes it */
+            host_window.queue.cq[tail % FFT_QUEUE_DEPTH] = desc;
+            __builtin_k1_wpurge();
+            __builtin_k1_fence();
+            host_window.queue.cq_tail = ++tail;
+            __builtin_k1_wpurge();
+            __builtin_k1_fence();
+            mOS_dinval();
+        }
+        if (host_window.shutdown)
+            break;
+    }
+    printf("# [IODDR0] host queue served %d request(s), %d failed\n", served, failed);
+
+    service_command(g, FFT_CMD_SHUTDOWN);
+    return service_waitpid(g) != 0 ? -1 : 0;
+}
+#endif
+
+int main() {
+    mppadesc_t pcie_fd = 0;
+    if (__k1_spawn_type() == __MPPA_PCI_SPAWN) {
+        pcie_fd = pcie_open(0);
+        pcie_queue_init(pcie_fd);
+        pcie_register_console(pcie_fd, stdin, stdout);
+    }
+    int nb_used = groups_parse();
+    if (nb_used < 0)
+        return -1;
+    mppa_rpc_server_init(1, 0, nb_used);
+    mppa_async_server_init();
+    mppa_remote_server_init(pcie_fd, nb_used);
+
+#ifdef FFT_SERVICE
+    utask_t t;
+    utask_create(&t, NULL, (void*)mppa_rpc_server_start, NULL);
+
+#ifdef FFT_HOST_QUEUE
+    int diff = host_queue_run(&groups[0]);
+#else
+    int diff = service_run(&groups[0]);
+#endif
+#else
+    for(int g=0;g<nb_group;g++){
+#ifdef FFT_GROUPS
+        /* one binary per group, built for its cluster count and size */
+        char name[32], group[8], first[8];
+        const char *argv[] = {name, group, first, NULL};
+        snprintf(name, sizeof(name), "cluster_bin_g%d", g);
+        snprintf(group, sizeof(group), "%d", g);
+        snprintf(first, sizeof(first), "%d", groups[g].first);
+        printf("# [IODDR0] group %d: clusters %d-%d FFT %d x %d (%s)\n", g, groups[g].first,
+               groups[g].first + groups[g].nb_cluster - 1, groups[g].width, groups[g].height, name);
+#else
+        const char *name = "cluster_bin";
+        const char **argv = NULL;
+#endif
+        for(int i=groups[g].first;i<groups[g].first+groups[g].nb_cluster;i++){
+            if (mppa_power_base_spawn(i, name, argv, NULL, MPPA_POWER_SHUFFLING_ENABLED) == -1)
+                printf("# [IODDR0] Fail to Spawn cluster %d\n", i);
+        }
+    }
+
+    utask_t t;
+    utask_create(&t, NULL, (void*)mppa_rpc_server_start, NULL);
+
+    for(int g=0;g<nb_group;g++){
+        if (group_setup(&groups[g], g, groups[g].width*groups[g].height, 0) != 0)
+            return -1;
+    }
+
+    int status = 0;
+    for(int i=0;i<nb_used;i++){
+        int ret;
+        if (mppa_power_base_waitpid(i, &ret, 0) < 0) {
+            printf("# [IODDR0] Waitpid failed on cluster %d\n", i);
+        }
+        status += ret;
+    }
+    if(status != 0)
+        return -1;
+
+    mOS_dinval();
+    printf("# IO%d starts checking. Please wait.\n", __k1_get_cluster_id());
+    int diff = 0;
+    for(int g=0;g<nb_group;g++){
+        diff += group_check(&groups[g], g);
     }
+#endif
     if(diff)
     {
-        printf("# [IODDR0] real_diff %e im_diff %e diff %d %s\n", real_diff, im_diff, diff, string);
         return -1;
     }
 
@@ -250,6 +1314,6 @@ int main() {
         pcie_unregister_console(pcie_fd);
         pcie_queue_exit(pcie_fd, 0, NULL);
     }
-    printf("# [IODDR0] Goodbye\n");
+    printf("# [IODDR0] Goodbye\n");
     return 0;
 }